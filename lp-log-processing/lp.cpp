@@ -85,10 +85,19 @@ struct Parameters {
     Time_Policy_t    time_policy               = Time_Policy_t::INGRESS_TIME;
     unsigned         parallelism[num_nodes]    = {1, 1, 1, 1, 1, 1};
     unsigned         batch_size[num_nodes - 1] = {0, 0, 0, 0, 0};
+    vector<unsigned> affinity[num_nodes];
     unsigned         duration                  = 60;
     unsigned         tuple_rate                = 0;
     unsigned         sampling_rate             = 100;
+    unsigned         live_interval             = 0;
     bool             use_chaining              = false;
+    bool             collect_operator_stats    = false;
+    bool             use_tracing               = false;
+    bool             collect_perf_counters     = false;
+    const char *     sampling_policy           = "time";
+    const char *     warmup                    = "none";
+    const char *     load_profile              = "constant";
+    bool             use_open_loop             = false;
 };
 
 enum class TupleTag { Volume, Status, Geo };
@@ -102,12 +111,14 @@ struct SourceTuple {
     unsigned      byte_size;
     unsigned long minute_timestamp;
     unsigned long timestamp;
+    TupleTrace    trace {};
 };
 
 struct GeoFinderOutputTuple {
     string        country;
     string        city;
     unsigned long timestamp;
+    TupleTrace    trace {};
 };
 
 struct OutputTuple {
@@ -120,6 +131,7 @@ struct OutputTuple {
     unsigned long minute;
     unsigned long count;
     unsigned long timestamp;
+    TupleTrace    trace {};
 };
 
 static const struct option long_opts[] = {{"help", 0, 0, 'h'},
@@ -132,6 +144,15 @@ static const struct option long_opts[] = {{"help", 0, 0, 'h'},
                                           {"outputdir", 1, 0, 'o'},
                                           {"execmode", 1, 0, 'e'},
                                           {"timepolicy", 1, 0, 't'},
+                                          {"liveinterval", 1, 0, 'i'},
+                                          {"operatorstats", 1, 0, 'O'},
+                                          {"openloop", 1, 0, 'l'},
+                                          {"profile", 1, 0, 'L'},
+                                          {"warmup", 1, 0, 'w'},
+                                          {"samplingpolicy", 1, 0, 'S'},
+                                          {"perfcounters", 1, 0, 'C'},
+                                          {"affinity", 1, 0, 'A'},
+                                          {"tracing", 1, 0, 'H'},
                                           {0, 0, 0, 0}};
 
 class MMDB_handle {
@@ -320,8 +341,9 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
     int option;
     int index;
 
-    while ((option = getopt_long(argc, argv, "r:s:p:b:c:d:o:e:t:h", long_opts,
-                                 &index))
+    while ((option = getopt_long(argc, argv,
+                                 "r:s:p:b:c:d:o:e:t:i:O:l:L:w:S:C:A:H:h",
+                                 long_opts, &index))
            != -1) {
         switch (option) {
         case 'r':
@@ -356,6 +378,19 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
                 }
             }
         } break;
+        case 'A': {
+            const auto core_lists = get_affinity_from_string(optarg);
+            if (core_lists.size() != num_nodes) {
+                cerr << "Error in parsing the input arguments.  Affinity "
+                        "string requires exactly "
+                     << num_nodes << " core lists.\n";
+                exit(EXIT_FAILURE);
+            } else {
+                for (unsigned i = 0; i < num_nodes; ++i) {
+                    parameters.affinity[i] = core_lists[i];
+                }
+            }
+        } break;
         case 'c':
             parameters.use_chaining = get_bool_from_string(optarg);
             break;
@@ -371,13 +406,45 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
         case 't':
             parameters.time_policy = get_time_policy_from_string(optarg);
             break;
+        case 'i':
+            parameters.live_interval = atoi(optarg);
+            break;
+        case 'O':
+            parameters.collect_operator_stats = get_bool_from_string(optarg);
+            break;
+        case 'l':
+            parameters.use_open_loop = get_bool_from_string(optarg);
+            break;
+        case 'L':
+            parameters.load_profile = optarg;
+            break;
+        case 'w':
+            parameters.warmup = optarg;
+            break;
+        case 'S':
+            parameters.sampling_policy = optarg;
+            break;
+        case 'C':
+            parameters.collect_perf_counters = get_bool_from_string(optarg);
+            break;
+        case 'H':
+            parameters.use_tracing = get_bool_from_string(optarg);
+            break;
         case 'h':
             cout << "Parameters: --rate <value> --sampling "
                     "<value> --batch <size> --parallelism "
                     "<nSource,nVolumeCounter,nStatusCounter,nGeoFinder,"
                     "nGeoStats,nSink> "
                     "[--duration <seconds>] "
-                    "[--chaining <value>]\n";
+                    "[--chaining <value>] [--liveinterval <msec>] "
+                    "[--operatorstats <value>] "
+                    "[--openloop <value>] "
+                    "[--profile <shape[,argument...]>] "
+                    "[--warmup <mode[,argument]>] "
+                    "[--samplingpolicy <policy[,argument]>] "
+                    "[--perfcounters <value>] "
+                    "[--affinity <cores,cores,...>] "
+                    "[--tracing <value>]\n";
             exit(EXIT_SUCCESS);
             break;
         default:
@@ -402,6 +469,29 @@ static inline void validate_args(const Parameters &parameters) {
             exit(EXIT_FAILURE);
         }
     }
+
+    if (parameters.use_open_loop && parameters.tuple_rate == 0) {
+        cerr << "Error: open-loop generation requires a positive tuple "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (string {parameters.load_profile} != "constant"
+        && parameters.tuple_rate == 0) {
+        cerr << "Error: load profiles other than constant need a positive "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+    if (parameters.tuple_rate > 0) {
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration);
+    }
+
+    get_warmup_from_string(parameters.warmup, parameters.duration);
+
+    get_sampling_policy_from_string(parameters.sampling_policy,
+                                    parameters.sampling_rate);
 }
 
 static inline void print_initial_parameters(const Parameters &parameters) {
@@ -453,19 +543,56 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 
     cout << "Chaining:\t" << (parameters.use_chaining ? "enabled" : "disabled")
          << '\n';
+
+    cout << "Live metrics interval:\t";
+    if (parameters.live_interval > 0) {
+        cout << parameters.live_interval << " ms\n";
+    } else {
+        cout << "disabled\n";
+    }
+
+    cout << "Per-operator statistics:\t"
+         << (parameters.collect_operator_stats ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Open-loop generation:\t"
+         << (parameters.use_open_loop ? "enabled" : "disabled") << '\n';
+
+    cout << "Load profile:\t" << parameters.load_profile << '\n';
+
+    cout << "Warm-up:\t" << parameters.warmup << '\n';
+
+    cout << "Sampling policy:\t" << parameters.sampling_policy << '\n';
+
+    cout << "Performance counters:\t"
+         << (parameters.collect_perf_counters ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Affinity:\t";
+    for (unsigned i = 0; i < num_nodes; ++i) {
+        cout << (i > 0 ? "," : "")
+             << get_string_from_core_list(parameters.affinity[i]);
+    }
+    cout << '\n';
+
+    cout << "Per-hop tracing:\t"
+         << (parameters.use_tracing ? "enabled" : "disabled") << '\n';
 }
 
 static inline void
-print_statistics(unsigned long elapsed_time, unsigned long duration,
-                 unsigned long sent_tuples, double average_total_latency,
-                 double average_volume_latency, double average_status_latency,
-                 double average_geo_latency, unsigned long received_tuples) {
+print_statistics(unsigned long elapsed_time, unsigned long measured_time,
+                 unsigned long duration, unsigned long sent_tuples,
+                 double average_total_latency, double average_volume_latency,
+                 double average_status_latency, double average_geo_latency,
+                 unsigned long received_tuples) {
     const double elapsed_time_in_seconds =
         elapsed_time / static_cast<double>(timeunit_scale_factor);
+    const double measured_time_in_seconds =
+        measured_time / static_cast<double>(timeunit_scale_factor);
 
     const double throughput =
-        elapsed_time > 0 ? sent_tuples / static_cast<double>(elapsed_time)
-                         : sent_tuples;
+        measured_time > 0 ? sent_tuples / static_cast<double>(measured_time)
+                          : sent_tuples;
 
     const double throughput_in_seconds = throughput * timeunit_scale_factor;
     const double service_time          = 1 / throughput;
@@ -485,6 +612,8 @@ print_statistics(unsigned long elapsed_time, unsigned long duration,
          << "Excess time after source stopped: "
          << elapsed_time - duration * timeunit_scale_factor << ' '
          << timeunit_string << "s\n"
+         << "Measured time: " << measured_time << ' ' << timeunit_string
+         << "s (" << measured_time_in_seconds << " seconds)\n"
          << "Total number of tuples sent: " << sent_tuples << '\n'
          << "Total number of tuples recieved: " << received_tuples << '\n'
          << "Processed about " << throughput << " tuples per "
@@ -520,6 +649,9 @@ static Metric<unsigned long> global_volume_latency_metric {
 static Metric<unsigned long> global_status_latency_metric {
     "lp-status-latency"};
 static Metric<unsigned long> global_geo_latency_metric {"lp-geo-latency"};
+static Metric<unsigned long> global_schedule_lag_metric {"lp-schedule-lag"};
+static LiveMetricsReporter   global_live_metrics;
+static OperatorStatsRegistry global_operator_stats;
 #ifndef NDEBUG
 static mutex print_mutex;
 #endif
@@ -528,12 +660,15 @@ class SourceFunctor {
     vector<SourceTuple> logs;
     unsigned long       duration;
     unsigned            tuple_rate_per_second;
+    LoadProfile         load_profile;
+    bool                open_loop;
 
 public:
-    SourceFunctor(unsigned d, unsigned rate,
-                  const char *path = "http-server.log")
+    SourceFunctor(unsigned d, const LoadProfile &profile,
+                  bool open_loop = false, const char *path = "http-server.log")
         : logs {parse_logs(path)}, duration {d * timeunit_scale_factor},
-          tuple_rate_per_second {rate} {
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile}, open_loop {open_loop} {
         if (logs.empty()) {
             cerr << "Error: empty log stream.  Check whether log file exists "
                     "and is readable\n";
@@ -543,12 +678,24 @@ public:
 
     void operator()(Source_Shipper<SourceTuple> &shipper,
                     RuntimeContext &             context) {
-        DO_NOT_WARN_IF_UNUSED(context);
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
-        size_t              index       = 0;
+        if (global_thread_placement.pin_current_thread(
+                "source", context.getReplicaIndex())) {
+            copy_to_local_numa_node(logs);
+        }
+
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
+        size_t              index           = 0;
+        TraceSampler        trace_sampler;
 
-        while (current_time() < end_time) {
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, open_loop);
+        }
+
+        while (!deadline.has_expired()) {
             auto volume_source_tuple     = logs[index];
             auto status_source_tuple     = logs[index];
             auto geo_finder_source_tuple = logs[index];
@@ -564,25 +711,38 @@ public:
             status_source_tuple.tag     = TupleTag::Status;
             geo_finder_source_tuple.tag = TupleTag::Geo;
 
-            const unsigned long timestamp     = current_time();
+            const unsigned long timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
             volume_source_tuple.timestamp     = timestamp;
             status_source_tuple.timestamp     = timestamp;
             geo_finder_source_tuple.timestamp = timestamp;
 
+            const auto trace = trace_sampler.start_trace(timestamp);
+
+            volume_source_tuple.trace     = trace;
+            status_source_tuple.trace     = trace;
+            geo_finder_source_tuple.trace = trace;
+
             shipper.push(move(volume_source_tuple));
             shipper.push(move(status_source_tuple));
             shipper.push(move(geo_finder_source_tuple));
 
-            sent_tuples += 3;
-            index = (index + 1) % logs.size();
-
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            if (global_measurement_window.contains(timestamp)) {
+                sent_tuples += 3;
+            } else {
+                excluded_tuples += 3;
             }
+            live_counters.add_tuples(3);
+            index = (index + 1) % logs.size();
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
+        if (open_loop) {
+            global_schedule_lag_metric.merge(
+                rate_controller->get_lag_samples());
+        }
     }
 };
 
@@ -664,6 +824,7 @@ public:
         output.minute    = minute;
         output.count     = counts.find(minute)->second;
         output.timestamp = input.timestamp;
+        output.trace     = input.trace.forwarded();
         return output;
     }
 };
@@ -694,6 +855,7 @@ public:
         output.status_code = status_code;
         output.count       = counts.find(status_code)->second;
         output.timestamp   = input.timestamp;
+        output.trace       = input.trace.forwarded();
         return output;
     }
 };
@@ -763,7 +925,8 @@ public:
             const auto &city    = ip_info.second;
             GeoFinderOutputTuple output {country ? *country : "null",
                                          city ? *city : "null",
-                                         input.timestamp};
+                                         input.timestamp,
+                                         input.trace.forwarded()};
             shipper.push(move(output));
         }
     }
@@ -798,39 +961,35 @@ public:
         output.city          = input.city;
         output.city_total    = current_stats.get_city_total(input.city);
         output.timestamp     = input.timestamp;
+        output.trace         = input.trace.forwarded();
         return output;
     }
 };
 
 class SinkFunctor {
-    vector<unsigned long>                          latency_samples;
-    unordered_map<TupleTag, vector<unsigned long>> specific_latency_samples {
-        {TupleTag::Volume, {}}, {TupleTag::Status, {}}, {TupleTag::Geo, {}}};
+    LatencySampler                          latency_samples;
+    unordered_map<TupleTag, LatencySampler> specific_latency_samples;
 
     unsigned long                          tuples_received = 0;
     unordered_map<TupleTag, unsigned long> specific_tuples_received {
         {TupleTag::Volume, 0}, {TupleTag::Status, 0}, {TupleTag::Geo, 0}};
 
-    unsigned long last_sampling_time = current_time();
-    unsigned long last_arrival_time  = last_sampling_time;
-    unsigned      sampling_rate;
-
-    bool is_time_to_sample(unsigned long arrival_time) const {
-        if (sampling_rate == 0) {
-            return true;
-        }
-        const unsigned long time_since_last_sampling =
-            difference(arrival_time, last_sampling_time);
-        const unsigned long time_between_samples =
-            (1.0 / sampling_rate) * timeunit_scale_factor;
-        return time_since_last_sampling >= time_between_samples;
-    }
+    HopSamples                      hop_samples;
+    optional<ReplicaCountersHandle> live_counters;
+    unsigned long                   last_arrival_time = current_time();
 
 public:
-    SinkFunctor(unsigned rate) : sampling_rate {rate} {}
+    SinkFunctor(const SamplingPolicy &policy)
+        : latency_samples {policy},
+          specific_latency_samples {{TupleTag::Volume, policy},
+                                    {TupleTag::Status, policy},
+                                    {TupleTag::Geo, policy}} {}
 
     void operator()(optional<OutputTuple> &input, RuntimeContext &context) {
         DO_NOT_WARN_IF_UNUSED(context);
+        if (!live_counters) {
+            live_counters = global_live_metrics.add_sink_replica();
+        }
         if (input) {
             assert(input->tag == TupleTag::Volume
                    || input->tag == TupleTag::Status
@@ -840,14 +999,22 @@ public:
             const unsigned long latency =
                 difference(arrival_time, input->timestamp);
 
-            ++tuples_received;
-            ++specific_tuples_received[input->tag];
+            const bool is_measured =
+                global_measurement_window.contains(arrival_time);
+            if (is_measured) {
+                ++tuples_received;
+                ++specific_tuples_received[input->tag];
+                hop_samples.record(input->trace);
+            }
+            live_counters->add_tuples();
             last_arrival_time = arrival_time;
 
-            if (is_time_to_sample(arrival_time)) {
-                latency_samples.push_back(latency);
-                specific_latency_samples[input->tag].push_back(latency);
-                last_sampling_time = arrival_time;
+            if (latency_samples.should_sample(arrival_time)) {
+                if (is_measured) {
+                    latency_samples.record(latency);
+                    specific_latency_samples[input->tag].record(latency);
+                }
+                live_counters->record_latency(latency);
 #ifndef NDEBUG
                 {
                     lock_guard lock {print_mutex};
@@ -877,20 +1044,26 @@ public:
             global_geo_received_tuples.fetch_add(
                 specific_tuples_received[TupleTag::Geo]);
 
-            global_total_latency_metric.merge(latency_samples);
+            global_total_latency_metric.merge(latency_samples.get_samples());
             global_volume_latency_metric.merge(
-                specific_latency_samples[TupleTag::Volume]);
+                specific_latency_samples[TupleTag::Volume].get_samples());
             global_status_latency_metric.merge(
-                specific_latency_samples[TupleTag::Status]);
+                specific_latency_samples[TupleTag::Status].get_samples());
             global_geo_latency_metric.merge(
-                specific_latency_samples[TupleTag::Geo]);
+                specific_latency_samples[TupleTag::Geo].get_samples());
+            global_hop_tracer.merge(hop_samples);
         }
     }
 };
 
 static inline PipeGraph &build_graph(const Parameters &parameters,
                                      PipeGraph &       graph) {
-    SourceFunctor source_functor {parameters.duration, parameters.tuple_rate};
+    SourceFunctor source_functor {
+        parameters.duration,
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration),
+        parameters.use_open_loop};
     const auto    source_node =
         Source_Builder {source_functor}
             .withParallelism(parameters.parallelism[source_id])
@@ -898,8 +1071,9 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
             .withOutputBatchSize(parameters.batch_size[source_id])
             .build();
 
-    VolumeCounterFunctor volume_counter_functor;
-    const auto           volume_counter_node =
+    InstrumentedFunctor volume_counter_functor {
+        VolumeCounterFunctor {}, "volume counter", global_operator_stats};
+    const auto volume_counter_node =
         Map_Builder {volume_counter_functor}
             .withParallelism(parameters.parallelism[volume_counter_id])
             .withName("volume counter")
@@ -909,8 +1083,9 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
             })
             .build();
 
-    StatusCounterFunctor status_counter_functor;
-    const auto           status_counter_node =
+    InstrumentedFunctor status_counter_functor {
+        StatusCounterFunctor {}, "status counter", global_operator_stats};
+    const auto status_counter_node =
         Map_Builder {status_counter_functor}
             .withParallelism(parameters.parallelism[status_counter_id])
             .withName("status counter")
@@ -919,16 +1094,18 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
                 [](const SourceTuple &t) -> unsigned { return t.response; })
             .build();
 
-    GeoFinderFunctor geo_finder_functor;
-    const auto       geo_finder_node =
+    InstrumentedFunctor geo_finder_functor {
+        GeoFinderFunctor {}, "geo finder", global_operator_stats};
+    const auto geo_finder_node =
         FlatMap_Builder {geo_finder_functor}
             .withParallelism(parameters.parallelism[geo_finder_id])
             .withName("geo finder")
             .withOutputBatchSize(parameters.batch_size[geo_finder_id])
             .build();
 
-    GeoStatsFunctor geo_stats_functor;
-    const auto      geo_stats_node =
+    InstrumentedFunctor geo_stats_functor {
+        GeoStatsFunctor {}, "geo stats", global_operator_stats};
+    const auto geo_stats_node =
         Map_Builder {geo_stats_functor}
             .withParallelism(parameters.parallelism[geo_stats_id])
             .withName("geo stats")
@@ -938,8 +1115,11 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
             })
             .build();
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink_node =
+    InstrumentedFunctor sink_functor {
+        SinkFunctor {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink_node =
         Sink_Builder {sink_functor}
             .withParallelism(parameters.parallelism[sink_id])
             .withName("sink")
@@ -987,18 +1167,51 @@ int main(int argc, char *argv[]) {
     validate_args(parameters);
     print_initial_parameters(parameters);
 
+    global_thread_placement.assign("source", parameters.affinity[source_id]);
+    global_thread_placement.assign("volume counter",
+                                   parameters.affinity[volume_counter_id]);
+    global_thread_placement.assign("status counter",
+                                   parameters.affinity[status_counter_id]);
+    global_thread_placement.assign("geo finder",
+                                   parameters.affinity[geo_finder_id]);
+    global_thread_placement.assign("geo stats",
+                                   parameters.affinity[geo_stats_id]);
+    global_thread_placement.assign("sink", parameters.affinity[sink_id]);
+
     PipeGraph graph {"lp-log-processing", parameters.execution_mode,
                      parameters.time_policy};
     build_graph(parameters, graph);
 
+    if (parameters.live_interval > 0) {
+        global_live_metrics.start(parameters.live_interval, "lp-live",
+                                  parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        global_operator_stats.enable(parameters.collect_perf_counters);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.enable(
+            get_sampling_policy_from_string(parameters.sampling_policy,
+                                            parameters.sampling_rate),
+            "lp");
+    }
+
+    global_measurement_window.start(
+        get_warmup_from_string(parameters.warmup, parameters.duration),
+        parameters.duration, global_live_metrics);
     const unsigned long start_time = current_time();
     graph.run();
     const unsigned long elapsed_time = difference(current_time(), start_time);
+    global_measurement_window.stop();
+    global_live_metrics.stop();
+    const unsigned long measured_time =
+        global_measurement_window.get_measured_time();
 
 #if defined(NDEBUG) && !defined(PROFILE)
     const double throughput =
-        elapsed_time > 0
-            ? (global_sent_tuples.load() / static_cast<double>(elapsed_time))
+        measured_time > 0
+            ? (global_sent_tuples.load() / static_cast<double>(measured_time))
             : global_sent_tuples.load();
 
     const double service_time = 1 / throughput;
@@ -1034,39 +1247,33 @@ int main(int argc, char *argv[]) {
         service_time, "service time", parameters, global_sent_tuples);
     serialize_json(service_time_stats, "lp-service-time",
                    parameters.metric_output_directory);
+
+    if (parameters.use_open_loop) {
+        const auto schedule_lag_stats = get_distribution_stats(
+            global_schedule_lag_metric, parameters, global_sent_tuples);
+        serialize_json(schedule_lag_stats, "lp-schedule-lag",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        const auto operator_stats = get_operator_stats(
+            global_operator_stats, "lp-operators", parameters);
+        serialize_json(operator_stats, "lp-operators",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.serialize(parameters);
+    }
 #endif
 
-    const double average_total_latency =
-        accumulate(global_total_latency_metric.begin(),
-                   global_total_latency_metric.end(), 0.0)
-        / (!global_total_latency_metric.empty()
-               ? global_total_latency_metric.size()
-               : 1.0);
-
-    const double average_volume_latency =
-        accumulate(global_volume_latency_metric.begin(),
-                   global_volume_latency_metric.end(), 0.0)
-        / (!global_volume_latency_metric.empty()
-               ? global_volume_latency_metric.size()
-               : 1.0);
-
-    const double average_status_latency =
-        accumulate(global_status_latency_metric.begin(),
-                   global_status_latency_metric.end(), 0.0)
-        / (!global_status_latency_metric.empty()
-               ? global_status_latency_metric.size()
-               : 1.0);
-
-    const double average_geo_latency =
-        accumulate(global_geo_latency_metric.begin(),
-                   global_geo_latency_metric.end(), 0.0)
-        / (!global_geo_latency_metric.empty()
-               ? global_geo_latency_metric.size()
-               : 1.0);
-
-    print_statistics(elapsed_time, parameters.duration, global_sent_tuples,
-                     average_total_latency, average_volume_latency,
-                     average_status_latency, average_geo_latency,
-                     global_received_tuples);
+    const double average_total_latency = global_total_latency_metric.mean();
+    const double average_volume_latency = global_volume_latency_metric.mean();
+    const double average_status_latency = global_status_latency_metric.mean();
+    const double average_geo_latency = global_geo_latency_metric.mean();
+
+    print_statistics(elapsed_time, measured_time, parameters.duration,
+                     global_sent_tuples, average_total_latency,
+                     average_volume_latency, average_status_latency,
+                     average_geo_latency, global_received_tuples);
     return 0;
 }
@@ -11,6 +11,7 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <cmath>
@@ -25,7 +26,6 @@
 #include <nlohmann/json.hpp>
 #include <numeric>
 #include <optional>
-#include <queue>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -35,6 +35,10 @@
 #include <valarray>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "../util.hpp"
 
 #ifdef __GNUC__
@@ -84,6 +88,7 @@ enum NodeId : unsigned {
  */
 struct Parameters {
     const char *     metric_output_directory = ".";
+    const char *     observation_scorer_type = "columnar";
     const char *     anomaly_scorer_type     = "data-stream";
     const char *     alert_triggerer_type    = "top-k";
     const char *     parser_type             = "alibaba";
@@ -92,23 +97,84 @@ struct Parameters {
     Time_Policy_t    time_policy             = Time_Policy_t::EVENT_TIME;
     unsigned         parallelism[num_nodes]  = {1, 1, 1, 1, 1};
     unsigned         batch_size[num_nodes - 1] = {0, 0, 0, 0};
+    vector<unsigned> affinity[num_nodes];
     unsigned         duration                  = 60;
     unsigned         tuple_rate                = 0;
     unsigned         sampling_rate             = 100;
+    unsigned         live_interval             = 0;
+    unsigned         top_k                     = 3;
     bool             use_chaining              = false;
+    bool             collect_operator_stats    = false;
+    bool             use_tracing               = false;
+    bool             collect_perf_counters     = false;
+    const char *     sampling_policy           = "time";
+    const char *     warmup                    = "none";
+    const char *     load_profile              = "constant";
+    bool             use_open_loop             = false;
+};
+
+/*
+ * Number of features observations are scored on: CPU and memory usage, then
+ * as many of the columns following them in the trace as building with a
+ * larger MO_FEATURE_COUNT adds.
+ */
+#ifndef MO_FEATURE_COUNT
+#define MO_FEATURE_COUNT 2
+#endif
+
+static constexpr size_t feature_count = MO_FEATURE_COUNT;
+static_assert(feature_count >= 2 && feature_count <= 5,
+              "MO_FEATURE_COUNT must be between 2 and 5");
+
+/*
+ * Machine IDs are interned into dense integer handles while the trace is
+ * loaded, so that tuples carry and operators hash a single integer, and
+ * per-machine state can live in arrays indexed by handle.  Interning only
+ * happens before the graph runs; looking names up afterwards is lock-free.
+ */
+using MachineId = uint32_t;
+
+class MachineIdRegistry {
+    mutex                            intern_mutex;
+    unordered_map<string, MachineId> ids;
+    vector<string>                   names;
+
+public:
+    MachineId intern(string_view name) {
+        lock_guard lock {intern_mutex};
+        const auto [entry, inserted] = ids.try_emplace(
+            string {name}, static_cast<MachineId>(names.size()));
+        if (inserted) {
+            names.push_back(entry->first);
+        }
+        return entry->second;
+    }
+
+    const string &get_name(MachineId id) const {
+        assert(id < names.size());
+        return names[id];
+    }
+
+    size_t size() const {
+        return names.size();
+    }
 };
 
+static MachineIdRegistry global_machine_ids;
+
 struct MachineMetadata {
-    string        machine_ip;
-    double        cpu_usage;
-    double        memory_usage;
-    double        score;
-    unsigned long timestamp;
+    MachineId                        machine_id;
+    double                           cpu_usage;
+    double                           memory_usage;
+    double                           score;
+    unsigned long                    timestamp;
+    array<double, feature_count - 2> extra_usage {};
 };
 
 #ifndef NDEBUG
 ostream &operator<<(ostream &stream, const MachineMetadata &metadata) {
-    stream << "{Machine IP: " << metadata.machine_ip
+    stream << "{Machine IP: "
+           << global_machine_ids.get_name(metadata.machine_id)
            << ", CPU usage: " << metadata.cpu_usage
            << ", memory usage: " << metadata.memory_usage
            << ", observation timestamp: " << metadata.timestamp << '}';
@@ -118,115 +184,238 @@ ostream &operator<<(ostream &stream, const MachineMetadata &metadata) {
 
 template<typename T>
 struct ScorePackage {
-    string id;
-    double score;
-    T      data;
+    MachineId id;
+    double    score;
+    T         data;
 };
 
 template<typename T>
 struct StreamProfile {
-    string id;
-    T      current_data_instance;
-    double stream_anomaly_score;
-    double current_data_instance_score;
+    MachineId id;
+    T         current_data_instance;
+    double    stream_anomaly_score;
+    double    current_data_instance_score;
 };
 
 struct SourceTuple {
     MachineMetadata observation;
     unsigned long   ordering_timestamp;
     unsigned long   execution_timestamp;
+    TupleTrace      trace {};
 };
 
 struct ObservationResultTuple {
-    string          id;
+    MachineId       id;
     double          score;
     unsigned long   ordering_timestamp;
     unsigned long   parent_execution_timestamp;
     MachineMetadata observation;
+    TupleTrace      trace {};
 };
 
 struct AnomalyResultTuple {
-    string          id;
+    MachineId       id;
     double          anomaly_score;
     unsigned long   ordering_timestamp;
     unsigned long   parent_execution_timestamp;
     MachineMetadata observation;
     double          individual_score;
+    TupleTrace      trace {};
 };
 
-bool operator<(AnomalyResultTuple a, AnomalyResultTuple b) {
-    return a.anomaly_score < b.anomaly_score;
-}
-
 struct AlertTriggererResultTuple {
-    string          id;
+    MachineId       id;
     double          anomaly_score;
     unsigned long   parent_execution_timestamp;
     bool            is_abnormal;
     MachineMetadata observation;
+    TupleTrace      trace {};
 };
 
-template<typename Tuple>
-struct TimestampGreaterComparator {
-    bool operator()(const Tuple &t, const Tuple &s) {
-        return t.ordering_timestamp > s.ordering_timestamp;
+/*
+ * Holds tuples until the watermark passes their ordering timestamp, grouped
+ * in one bucket per timestamp, kept sorted.  Since timestamps mostly arrive
+ * in order, a tuple is usually appended to the last bucket or opens a new
+ * one, and every released bucket is moved out whole, its storage being
+ * reused by later buckets.  Tuples sharing a timestamp are released in
+ * arrival order.
+ */
+template<typename T>
+class TimestampReorderBuffer {
+    struct Bucket {
+        unsigned long ordering_timestamp;
+        vector<T>     tuples;
+    };
+
+    deque<Bucket>     buckets;
+    vector<vector<T>> spare_tuple_lists;
+    size_t            tuple_count = 0;
+
+    vector<T> get_tuple_list() {
+        if (spare_tuple_lists.empty()) {
+            return {};
+        }
+        auto tuple_list = move(spare_tuple_lists.back());
+        spare_tuple_lists.pop_back();
+        return tuple_list;
     }
-};
 
-template<typename T>
-using TimestampPriorityQueue =
-    priority_queue<T, vector<T>, TimestampGreaterComparator<T>>;
+    vector<T> &get_bucket(unsigned long ordering_timestamp) {
+        if (buckets.empty()
+            || buckets.back().ordering_timestamp < ordering_timestamp) {
+            buckets.push_back({ordering_timestamp, get_tuple_list()});
+            return buckets.back().tuples;
+        }
+        if (buckets.back().ordering_timestamp == ordering_timestamp) {
+            return buckets.back().tuples;
+        }
+
+        const auto position = lower_bound(
+            buckets.begin(), buckets.end(), ordering_timestamp,
+            [](const Bucket &bucket, unsigned long timestamp) {
+                return bucket.ordering_timestamp < timestamp;
+            });
+        if (position->ordering_timestamp == ordering_timestamp) {
+            return position->tuples;
+        }
+        return buckets
+            .insert(position, {ordering_timestamp, get_tuple_list()})
+            ->tuples;
+    }
+
+    template<typename F>
+    void release_front_bucket(F &&process) {
+        auto tuple_list = move(buckets.front().tuples);
+        buckets.pop_front();
+        tuple_count -= tuple_list.size();
+        for (const auto &tuple : tuple_list) {
+            process(tuple);
+        }
+        tuple_list.clear();
+        spare_tuple_lists.push_back(move(tuple_list));
+    }
+
+public:
+    void push(const T &tuple) {
+        get_bucket(tuple.ordering_timestamp).push_back(tuple);
+        ++tuple_count;
+    }
+
+    /*
+     * Pass every tuple whose ordering timestamp is not greater than the
+     * watermark to process, in timestamp order.
+     */
+    template<typename F>
+    void release_until(unsigned long watermark, F &&process) {
+        while (!buckets.empty()
+               && buckets.front().ordering_timestamp <= watermark) {
+            release_front_bucket(process);
+        }
+    }
+
+    template<typename F>
+    void release_all(F &&process) {
+        while (!buckets.empty()) {
+            release_front_bucket(process);
+        }
+    }
+
+    bool empty() const {
+        return tuple_count == 0;
+    }
+
+    size_t size() const {
+        return tuple_count;
+    }
+};
 
 template<typename Scorer>
 struct ObservationScorerData {
     Scorer                              scorer;
-    TimestampPriorityQueue<SourceTuple> tuple_queue;
+    TimestampReorderBuffer<SourceTuple> tuple_queue;
     vector<MachineMetadata>             observation_list;
     unsigned long                       previous_ordering_timestamp = 0;
     unsigned long                       parent_execution_timestamp;
+    TupleTrace                          parent_trace;
     Execution_Mode_t                    execution_mode;
     Shipper<ObservationResultTuple> *   shipper;
 };
 
+/*
+ * Stream profiles are kept densely, in arrival order, with their position
+ * indexed by machine handle (no_profile when a machine has none yet).
+ */
 template<typename T>
 struct DataStreamAnomalyScorerData {
-    unordered_map<string, StreamProfile<T>>        stream_profile_map;
-    TimestampPriorityQueue<ObservationResultTuple> tuple_queue;
+    static constexpr size_t no_profile = numeric_limits<size_t>::max();
+
+    vector<StreamProfile<T>>                       stream_profiles;
+    vector<size_t>                                 profile_positions;
+    TimestampReorderBuffer<ObservationResultTuple> tuple_queue;
     bool                                           shrink_next_round = false;
     unsigned long                previous_ordering_timestamp         = 0;
     unsigned long                parent_execution_timestamp          = 0;
+    TupleTrace                   parent_trace;
     Execution_Mode_t             execution_mode;
     Shipper<AnomalyResultTuple> *shipper;
 };
 
 struct SlidingWindowStreamAnomalyScorerData {
-    unordered_map<string, deque<double>>           sliding_window_map;
-    TimestampPriorityQueue<ObservationResultTuple> tuple_queue;
+    vector<deque<double>>                          sliding_windows;
+    TimestampReorderBuffer<ObservationResultTuple> tuple_queue;
     Execution_Mode_t                               execution_mode;
     size_t                                         window_length;
     unsigned long previous_timestamp = 0; // XXX: is this needed?
     Shipper<AnomalyResultTuple> *shipper;
 };
 
+/*
+ * Score of a buffered tuple together with its position, so that order
+ * statistics can be selected without moving the tuples themselves.  Ties
+ * are broken by position, making the order total.
+ */
+struct ScoredIndex {
+    double score;
+    size_t index;
+};
+
+static inline bool operator<(const ScoredIndex &a, const ScoredIndex &b) {
+    return a.score < b.score || (a.score == b.score && a.index < b.index);
+}
+
+static inline bool is_greater_score(const ScoredIndex &a,
+                                    const ScoredIndex &b) {
+    return b < a;
+}
+
 struct AlertTriggererData {
     inline static const double dupper = sqrt(2);
 
     unsigned long                              previous_ordering_timestamp = 0;
     unsigned long                              parent_execution_timestamp  = 0;
+    TupleTrace                                 parent_trace;
     vector<AnomalyResultTuple>                 stream_list;
-    TimestampPriorityQueue<AnomalyResultTuple> tuple_queue;
+    vector<ScoredIndex>                        score_list;
+    TimestampReorderBuffer<AnomalyResultTuple> tuple_queue;
     double           min_data_instance_score = numeric_limits<double>::max();
     double           max_data_instance_score = 0.0;
     Execution_Mode_t execution_mode;
     Shipper<AlertTriggererResultTuple> *shipper;
 };
 
+/*
+ * top_k is a min-heap of the (anomaly score, position) pairs of the k
+ * highest scoring tuples in stream_list, updated as tuples arrive.
+ */
 struct TopKAlertTriggererData {
     vector<AnomalyResultTuple>                 stream_list;
-    TimestampPriorityQueue<AnomalyResultTuple> tuple_queue;
+    vector<ScoredIndex>                        top_k;
+    vector<bool>                               is_top_k;
+    TimestampReorderBuffer<AnomalyResultTuple> tuple_queue;
     size_t                                     k;
     unsigned long                              previous_ordering_timestamp = 0;
     unsigned long                              parent_execution_timestamp  = 0;
+    TupleTrace                                 parent_trace;
     Execution_Mode_t                           execution_mode;
     Shipper<AlertTriggererResultTuple> *       shipper;
 };
@@ -240,11 +429,22 @@ static const struct option long_opts[] = {{"help", 0, 0, 'h'},
                                           {"duration", 1, 0, 'd'},
                                           {"execmode", 1, 0, 'e'},
                                           {"timepolicy", 1, 0, 't'},
+                                          {"liveinterval", 1, 0, 'i'},
+                                          {"operatorstats", 1, 0, 'O'},
                                           {"outputdir", 1, 0, 'o'},
                                           {"anomalyscorer", 1, 0, 'a'},
                                           {"alerttriggerer", 1, 0, 'g'},
+                                          {"topk", 1, 0, 'k'},
                                           {"file", 1, 0, 'f'},
                                           {"parser", 1, 0, 'P'},
+                                          {"openloop", 1, 0, 'l'},
+                                          {"profile", 1, 0, 'L'},
+                                          {"warmup", 1, 0, 'w'},
+                                          {"samplingpolicy", 1, 0, 'S'},
+                                          {"perfcounters", 1, 0, 'C'},
+                                          {"affinity", 1, 0, 'A'},
+                                          {"tracing", 1, 0, 'H'},
+                                          {"observationscorer", 1, 0, 'x'},
                                           {0, 0, 0, 0}};
 
 static inline optional<MachineMetadata>
@@ -260,10 +460,15 @@ parse_google_trace(const string &trace) {
         return {};
     }
 
-    metadata.machine_ip   = values[machine_id_index];
+    metadata.machine_id   =
+        global_machine_ids.intern(values[machine_id_index]);
     metadata.timestamp    = stoul(values[timestamp_index].data());
     metadata.cpu_usage    = stod(values[cpu_usage_index].data()) * 10;
     metadata.memory_usage = stod(values[memory_usage_index].data()) * 10;
+    for (size_t i = 0; i < metadata.extra_usage.size(); ++i) {
+        metadata.extra_usage[i] =
+            strtod(values[memory_usage_index + 1 + i].data(), nullptr) * 10;
+    }
     return metadata;
 }
 
@@ -280,10 +485,15 @@ parse_alibaba_trace(const string &trace) {
     const size_t    memory_usage_index = 3;
     MachineMetadata metadata;
 
-    metadata.machine_ip   = values[machine_id_index];
+    metadata.machine_id   =
+        global_machine_ids.intern(values[machine_id_index]);
     metadata.timestamp    = stoul(values[timestamp_index].data()) * 1000;
     metadata.cpu_usage    = stod(values[cpu_usage_index].data());
     metadata.memory_usage = stod(values[memory_usage_index].data());
+    for (size_t i = 0; i < metadata.extra_usage.size(); ++i) {
+        metadata.extra_usage[i] =
+            strtod(values[memory_usage_index + 1 + i].data(), nullptr);
+    }
     return metadata;
 }
 
@@ -313,7 +523,9 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
     int option;
     int index;
 
-    while ((option = getopt_long(argc, argv, "r:s:p:b:c:d:o:e:t:a:g:f:P:h",
+    while ((option = getopt_long(argc, argv,
+                                 "r:s:p:b:c:d:o:e:t:i:O:a:g:f:P:l:L:w:S:"
+                                 "C:A:H:x:k:h",
                                  long_opts, &index))
            != -1) {
         switch (option) {
@@ -349,6 +561,19 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
                 }
             }
         } break;
+        case 'A': {
+            const auto core_lists = get_affinity_from_string(optarg);
+            if (core_lists.size() != num_nodes) {
+                cerr << "Error in parsing the input arguments.  Affinity "
+                        "string requires exactly "
+                     << num_nodes << " core lists.\n";
+                exit(EXIT_FAILURE);
+            } else {
+                for (unsigned i = 0; i < num_nodes; ++i) {
+                    parameters.affinity[i] = core_lists[i];
+                }
+            }
+        } break;
         case 'c':
             parameters.use_chaining = get_bool_from_string(optarg);
             break;
@@ -364,19 +589,58 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
         case 't':
             parameters.time_policy = get_time_policy_from_string(optarg);
             break;
+        case 'i':
+            parameters.live_interval = atoi(optarg);
+            break;
+        case 'O':
+            parameters.collect_operator_stats = get_bool_from_string(optarg);
+            break;
+        case 'l':
+            parameters.use_open_loop = get_bool_from_string(optarg);
+            break;
+        case 'L':
+            parameters.load_profile = optarg;
+            break;
+        case 'w':
+            parameters.warmup = optarg;
+            break;
+        case 'S':
+            parameters.sampling_policy = optarg;
+            break;
+        case 'C':
+            parameters.collect_perf_counters = get_bool_from_string(optarg);
+            break;
+        case 'H':
+            parameters.use_tracing = get_bool_from_string(optarg);
+            break;
         case 'h':
             cout << "Parameters: --rate <value> --sampling "
                     "<value> --batch <size> --parallelism "
                     "<nSource,nObserver,nAnomalyScorer,nAlertTriggerer,nSink> "
-                    "[--duration <seconds>] [--chaining <value>]\n";
+                    "[--duration <seconds>] [--chaining <value>] "
+                    "[--liveinterval <msec>] [--operatorstats <value>] "
+                    "[--openloop <value>] "
+                    "[--profile <shape[,argument...]>] "
+                    "[--warmup <mode[,argument]>] "
+                    "[--samplingpolicy <policy[,argument]>] "
+                    "[--perfcounters <value>] "
+                    "[--affinity <cores,cores,...>] "
+                    "[--tracing <value>] "
+                    "[--observationscorer <type>] [--topk <value>]\n";
             exit(EXIT_SUCCESS);
             break;
+        case 'x':
+            parameters.observation_scorer_type = optarg;
+            break;
         case 'a':
             parameters.anomaly_scorer_type = optarg;
             break;
         case 'g':
             parameters.alert_triggerer_type = optarg;
             break;
+        case 'k':
+            parameters.top_k = atoi(optarg);
+            break;
         case 'f':
             parameters.input_file = optarg;
             break;
@@ -405,6 +669,35 @@ static inline void validate_args(const Parameters &parameters) {
             exit(EXIT_FAILURE);
         }
     }
+
+    if (parameters.use_open_loop && parameters.tuple_rate == 0) {
+        cerr << "Error: open-loop generation requires a positive tuple "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (string {parameters.load_profile} != "constant"
+        && parameters.tuple_rate == 0) {
+        cerr << "Error: load profiles other than constant need a positive "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+    if (parameters.tuple_rate > 0) {
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration);
+    }
+
+    get_warmup_from_string(parameters.warmup, parameters.duration);
+
+    get_sampling_policy_from_string(parameters.sampling_policy,
+                                    parameters.sampling_rate);
+
+    if (parameters.top_k == 0) {
+        cerr << "Error: the number of top streams to flag must be "
+                "positive\n";
+        exit(EXIT_FAILURE);
+    }
 }
 
 static inline void print_initial_parameters(const Parameters &parameters) {
@@ -454,10 +747,47 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 
     cout << "Chaining:\t" << (parameters.use_chaining ? "enabled" : "disabled")
          << '\n'
+         << "Observation Scorer variant:\t"
+         << parameters.observation_scorer_type << '\n'
          << "Anomaly Scorer variant:\t\t" << parameters.anomaly_scorer_type
          << '\n'
          << "Alert Triggerer variant:\t" << parameters.alert_triggerer_type
+         << '\n'
+         << "Top-K streams flagged:\t" << parameters.top_k << '\n';
+
+    cout << "Live metrics interval:\t";
+    if (parameters.live_interval > 0) {
+        cout << parameters.live_interval << " ms\n";
+    } else {
+        cout << "disabled\n";
+    }
+
+    cout << "Per-operator statistics:\t"
+         << (parameters.collect_operator_stats ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Open-loop generation:\t"
+         << (parameters.use_open_loop ? "enabled" : "disabled") << '\n';
+
+    cout << "Load profile:\t" << parameters.load_profile << '\n';
+
+    cout << "Warm-up:\t" << parameters.warmup << '\n';
+
+    cout << "Sampling policy:\t" << parameters.sampling_policy << '\n';
+
+    cout << "Performance counters:\t"
+         << (parameters.collect_perf_counters ? "enabled" : "disabled")
          << '\n';
+
+    cout << "Affinity:\t";
+    for (unsigned i = 0; i < num_nodes; ++i) {
+        cout << (i > 0 ? "," : "")
+             << get_string_from_core_list(parameters.affinity[i]);
+    }
+    cout << '\n';
+
+    cout << "Per-hop tracing:\t"
+         << (parameters.use_tracing ? "enabled" : "disabled") << '\n';
 }
 
 /*
@@ -466,6 +796,9 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 static atomic_ulong          global_sent_tuples {0};
 static atomic_ulong          global_received_tuples {0};
 static Metric<unsigned long> global_latency_metric {"mo-latency"};
+static Metric<unsigned long> global_schedule_lag_metric {"mo-schedule-lag"};
+static LiveMetricsReporter   global_live_metrics;
+static OperatorStatsRegistry global_operator_stats;
 #ifndef NDEBUG
 static mutex print_mutex;
 #endif
@@ -480,12 +813,16 @@ class SourceFunctor {
     unsigned long         measurement_timestamp_increase_step;
     unsigned long         duration;
     unsigned              tuple_rate_per_second;
+    LoadProfile           load_profile;
+    bool                  open_loop;
 
 public:
-    SourceFunctor(unsigned d, unsigned rate, Execution_Mode_t e,
-                  const char *path = default_path)
+    SourceFunctor(unsigned d, const LoadProfile &profile, Execution_Mode_t e,
+                  bool open_loop = false, const char *path = default_path)
         : observations {parse_metadata<parse_trace>(path)}, execution_mode {e},
-          duration {d * timeunit_scale_factor}, tuple_rate_per_second {rate} {
+          duration {d * timeunit_scale_factor},
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile}, open_loop {open_loop} {
         if (observations.empty()) {
             cerr << "Error: empty machine reading stream.  Check whether "
                     "dataset file exists and is readable\n";
@@ -495,12 +832,24 @@ public:
 
     void operator()(Source_Shipper<SourceTuple> &shipper,
                     RuntimeContext &             context) {
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
-        size_t              index       = 0;
-        DO_NOT_WARN_IF_UNUSED(context);
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
+        size_t              index           = 0;
+        TraceSampler        trace_sampler;
+
+        if (global_thread_placement.pin_current_thread(
+                "source", context.getReplicaIndex())) {
+            copy_to_local_numa_node(observations);
+        }
 
-        while (current_time() < end_time) {
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, open_loop);
+        }
+
+        while (!deadline.has_expired()) {
             auto current_observation = observations[index];
             current_observation.timestamp +=
                 measurement_timestamp_additional_amount;
@@ -526,25 +875,34 @@ public:
                     measurement_timestamp_increase_step;
             }
 
-            const unsigned long execution_timestamp = current_time();
+            const unsigned long execution_timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
 
-            SourceTuple new_tuple = {current_observation,
-                                     current_observation.timestamp,
-                                     execution_timestamp};
+            SourceTuple new_tuple = {
+                current_observation, current_observation.timestamp,
+                execution_timestamp,
+                trace_sampler.start_trace(execution_timestamp)};
 
             shipper.pushWithTimestamp(move(new_tuple),
                                       new_tuple.observation.timestamp);
             if (execution_mode == Execution_Mode_t::DEFAULT) {
                 shipper.setNextWatermark(new_tuple.observation.timestamp);
             }
-            ++sent_tuples;
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            if (global_measurement_window.contains(execution_timestamp)) {
+                ++sent_tuples;
+            } else {
+                ++excluded_tuples;
             }
+            live_counters.add_tuples();
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
+        if (open_loop) {
+            global_schedule_lag_metric.merge(
+                rate_controller->get_lag_samples());
+        }
     }
 };
 
@@ -565,14 +923,14 @@ class MachineMetadataScorer {
         const auto       column_number = matrix[0].size();
 
         for (size_t col = 0; col < column_number; ++col) {
-            double min = numeric_limits<double>::min();
-            double max = numeric_limits<double>::max();
+            double min = numeric_limits<double>::max();
+            double max = numeric_limits<double>::lowest();
 
             for (size_t row {0}; row < matrix.size(); ++row) {
                 if (matrix[row][col] < min) {
                     min = matrix[row][col];
                 }
-                if (matrix[row][col] > min) {
+                if (matrix[row][col] > max) {
                     max = matrix[row][col];
                 }
             }
@@ -587,7 +945,8 @@ class MachineMetadataScorer {
 
         valarray<double> centers(0.0, column_number);
         for (size_t col = 0; col < column_number; ++col) {
-            if (mins[col] == 0 && maxs[col] == 0) {
+            if (mins[col] == maxs[col]) {
+                centers[col] = mins[col];
                 continue;
             }
             for (size_t row = 0; row < matrix.size(); ++row) {
@@ -619,20 +978,171 @@ public:
     get_scores(const vector<MachineMetadata> &observation_list) const {
         vector<ScorePackage<MachineMetadata>> score_package_list;
 
-        valarray<valarray<double>> matrix(valarray<double>(0.0, 2),
-                                          observation_list.size());
+        valarray<valarray<double>> matrix(
+            valarray<double>(0.0, feature_count), observation_list.size());
 
         for (size_t i = 0; i < observation_list.size(); ++i) {
             const auto &metadata  = observation_list[i];
             matrix[i][cpu_idx]    = metadata.cpu_usage;
             matrix[i][memory_idx] = metadata.memory_usage;
+            for (size_t j = 0; j < metadata.extra_usage.size(); ++j) {
+                matrix[i][memory_idx + 1 + j] = metadata.extra_usage[j];
+            }
         }
 
         const auto l2distances = calculate_distance(matrix);
         for (size_t i = 0; i < observation_list.size(); ++i) {
             auto &                        metadata = observation_list[i];
             ScorePackage<MachineMetadata> package {
-                metadata.machine_ip, 1.0 + l2distances[i], move(metadata)};
+                metadata.machine_id, 1.0 + l2distances[i], move(metadata)};
+            score_package_list.push_back(move(package));
+        }
+
+        return score_package_list;
+    }
+};
+
+struct ColumnSummary {
+    double min;
+    double max;
+    double sum;
+};
+
+/*
+ * Minimum, maximum and sum of a feature column, gathered in a single pass.
+ */
+static inline ColumnSummary get_column_summary(const double *column,
+                                               size_t        size) {
+    assert(size > 0);
+    ColumnSummary summary {numeric_limits<double>::max(),
+                           numeric_limits<double>::lowest(), 0.0};
+    size_t        i = 0;
+#if defined(__AVX2__)
+    if (size >= 4) {
+        __m256d mins = _mm256_loadu_pd(column);
+        __m256d maxs = mins;
+        __m256d sums = _mm256_setzero_pd();
+        for (; i + 4 <= size; i += 4) {
+            const __m256d values = _mm256_loadu_pd(column + i);
+            mins                 = _mm256_min_pd(mins, values);
+            maxs                 = _mm256_max_pd(maxs, values);
+            sums                 = _mm256_add_pd(sums, values);
+        }
+        alignas(32) double lanes[3][4];
+        _mm256_store_pd(lanes[0], mins);
+        _mm256_store_pd(lanes[1], maxs);
+        _mm256_store_pd(lanes[2], sums);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            summary.min = min(summary.min, lanes[0][lane]);
+            summary.max = max(summary.max, lanes[1][lane]);
+            summary.sum += lanes[2][lane];
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        summary.min = min(summary.min, column[i]);
+        summary.max = max(summary.max, column[i]);
+        summary.sum += column[i];
+    }
+    return summary;
+}
+
+/*
+ * Add to each squared distance the square of (column[i] * scale - offset),
+ * i.e. the distance of the normalized value from the column centroid.
+ */
+static inline void add_squared_distances(const double *column, size_t size,
+                                         double scale, double offset,
+                                         double *squared_distances) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256d scales  = _mm256_set1_pd(scale);
+    const __m256d offsets = _mm256_set1_pd(offset);
+    for (; i + 4 <= size; i += 4) {
+        const __m256d values = _mm256_loadu_pd(column + i);
+        const __m256d deltas =
+            _mm256_sub_pd(_mm256_mul_pd(values, scales), offsets);
+        const __m256d totals = _mm256_loadu_pd(squared_distances + i);
+        _mm256_storeu_pd(squared_distances + i,
+                         _mm256_add_pd(totals, _mm256_mul_pd(deltas, deltas)));
+    }
+#endif
+    for (; i < size; ++i) {
+        const double delta = column[i] * scale - offset;
+        squared_distances[i] += delta * delta;
+    }
+}
+
+/*
+ * Computes the same scores as MachineMetadataScorer, but keeps each feature
+ * in its own contiguous column, reused across calls, so that normalization,
+ * centroid and distance computations run as vectorizable loops without
+ * per-observation allocations.
+ */
+template<size_t Features>
+class ColumnarMachineMetadataScorer {
+    static_assert(Features >= 2, "CPU and memory usage are always scored");
+    static constexpr size_t cpu_idx    = 0;
+    static constexpr size_t memory_idx = 1;
+
+    array<vector<double>, Features> columns;
+    vector<double>                  squared_distances;
+
+    void fill_columns(const vector<MachineMetadata> &observation_list) {
+        const auto size = observation_list.size();
+        for (auto &column : columns) {
+            column.resize(size);
+        }
+        for (size_t i = 0; i < size; ++i) {
+            const auto &metadata   = observation_list[i];
+            columns[cpu_idx][i]    = metadata.cpu_usage;
+            columns[memory_idx][i] = metadata.memory_usage;
+            for (size_t j = memory_idx + 1; j < Features; ++j) {
+                columns[j][i] = metadata.extra_usage[j - memory_idx - 1];
+            }
+        }
+    }
+
+    void calculate_squared_distances() {
+        const auto size = columns[0].size();
+        squared_distances.assign(size, 0.0);
+
+        for (size_t col = 0; col < Features; ++col) {
+            const auto summary = get_column_summary(columns[col].data(), size);
+            double     min     = summary.min;
+            double     max     = summary.max;
+            if (col == cpu_idx) {
+                min = 0.0;
+                max = 1.0;
+            } else if (col == memory_idx) {
+                min = 0.0;
+                max = 100.0;
+            }
+            if (max == min) {
+                continue;
+            }
+
+            const double scale  = 1.0 / (max - min);
+            const double center = (summary.sum - size * min) * scale / size;
+            add_squared_distances(columns[col].data(), size, scale,
+                                  min * scale + center,
+                                  squared_distances.data());
+        }
+    }
+
+public:
+    vector<ScorePackage<MachineMetadata>>
+    get_scores(const vector<MachineMetadata> &observation_list) {
+        vector<ScorePackage<MachineMetadata>> score_package_list;
+        score_package_list.reserve(observation_list.size());
+
+        fill_columns(observation_list);
+        calculate_squared_distances();
+        for (size_t i = 0; i < observation_list.size(); ++i) {
+            auto &                        metadata = observation_list[i];
+            ScorePackage<MachineMetadata> package {
+                metadata.machine_id, 1.0 + sqrt(squared_distances[i]),
+                move(metadata)};
             score_package_list.push_back(move(package));
         }
 
@@ -669,12 +1179,14 @@ void process_observations(const SourceTuple &tuple, RuntimeContext &context) {
             for (const auto &package : score_package_list) {
                 ObservationResultTuple result {
                     package.id, package.score, next_ordering_timestamp,
-                    data.parent_execution_timestamp, package.data};
+                    data.parent_execution_timestamp, package.data,
+                    data.parent_trace.forwarded()};
 #ifndef NDEBUG
                 {
                     lock_guard lock {print_mutex};
                     clog << "[OBSERVATION SCORER " << context.getReplicaIndex()
-                         << "] Sending tuple with id: " << result.id
+                         << "] Sending tuple with id: "
+                         << global_machine_ids.get_name(result.id)
                          << ", score: " << result.score
                          << ", ordering timestamp: "
                          << result.ordering_timestamp
@@ -692,6 +1204,7 @@ void process_observations(const SourceTuple &tuple, RuntimeContext &context) {
 
     if (data.observation_list.empty()) {
         data.parent_execution_timestamp = tuple.execution_timestamp;
+        data.parent_trace               = tuple.trace.received();
     }
     data.observation_list.push_back(tuple.observation);
 }
@@ -702,11 +1215,8 @@ void process_last_tuples(RuntimeContext &context) {
     auto &storage = context.getLocalStorage();
     if (storage.isContained("data")) {
         auto &data        = storage.get<Data>("data");
-        auto &tuple_queue = data.tuple_queue;
-
-        for (; !tuple_queue.empty(); tuple_queue.pop()) {
-            process(tuple_queue.top(), context);
-        }
+        data.tuple_queue.release_all(
+            [&](const Input &tuple) { process(tuple, context); });
         storage.remove<Data>("data");
     }
 }
@@ -749,11 +1259,9 @@ public:
         case Execution_Mode_t::DEFAULT:
             tuple_queue.push(tuple);
 
-            while (!tuple_queue.empty()
-                   && tuple_queue.top().ordering_timestamp <= watermark) {
-                process_observations<Scorer>(tuple_queue.top(), context);
-                tuple_queue.pop();
-            }
+            tuple_queue.release_until(watermark, [&](const auto &ready_tuple) {
+                process_observations<Scorer>(ready_tuple, context);
+            });
             break;
         default:
             cerr << "[OBSERVATION SCORER] Error: unknown execution mode\n";
@@ -792,19 +1300,19 @@ void process_data_stream_anomalies(const ObservationResultTuple &tuple,
                 ? context.getLastWatermark()
                 : data.previous_ordering_timestamp;
 
-        for (auto &entry : data.stream_profile_map) {
-            auto &stream_profile = entry.second;
+        for (auto &stream_profile : data.stream_profiles) {
             if (data.shrink_next_round) {
                 stream_profile.stream_anomaly_score = 0;
             }
 
             AnomalyResultTuple result {
-                entry.first,
+                stream_profile.id,
                 stream_profile.stream_anomaly_score,
                 next_ordering_timestamp,
                 data.parent_execution_timestamp,
                 stream_profile.current_data_instance,
                 stream_profile.current_data_instance_score,
+                data.parent_trace.forwarded(),
             };
 #ifndef NDEBUG
             {
@@ -827,16 +1335,22 @@ void process_data_stream_anomalies(const ObservationResultTuple &tuple,
         }
         data.previous_ordering_timestamp = tuple.ordering_timestamp;
         data.parent_execution_timestamp  = tuple.parent_execution_timestamp;
+        data.parent_trace                = tuple.trace.received();
     }
 
-    const auto profile_entry = data.stream_profile_map.find(tuple.id);
+    if (tuple.id >= data.profile_positions.size()) {
+        data.profile_positions.resize(
+            max<size_t>(tuple.id + 1, global_machine_ids.size()),
+            data.no_profile);
+    }
+    auto &position = data.profile_positions[tuple.id];
 
-    if (profile_entry == data.stream_profile_map.end()) {
-        StreamProfile<T> profile {tuple.id, tuple.observation, tuple.score,
-                                  tuple.score};
-        data.stream_profile_map.insert({tuple.id, move(profile)});
+    if (position == data.no_profile) {
+        position = data.stream_profiles.size();
+        data.stream_profiles.push_back(
+            {tuple.id, tuple.observation, tuple.score, tuple.score});
     } else {
-        auto &profile = profile_entry->second;
+        auto &profile = data.stream_profiles[position];
         profile.stream_anomaly_score =
             profile.stream_anomaly_score * factor + tuple.score;
         profile.current_data_instance       = tuple.observation;
@@ -845,7 +1359,6 @@ void process_data_stream_anomalies(const ObservationResultTuple &tuple,
         if (profile.stream_anomaly_score > threshold) {
             data.shrink_next_round = true;
         }
-        data.stream_profile_map.insert_or_assign(tuple.id, profile);
     }
 }
 
@@ -888,11 +1401,9 @@ public:
         case Execution_Mode_t::DEFAULT:
             tuple_queue.push(tuple);
 
-            while (!tuple_queue.empty()
-                   && tuple_queue.top().ordering_timestamp <= watermark) {
-                process_data_stream_anomalies<T>(tuple_queue.top(), context);
-                tuple_queue.pop();
-            }
+            tuple_queue.release_until(watermark, [&](const auto &ready_tuple) {
+                process_data_stream_anomalies<T>(ready_tuple, context);
+            });
             break;
         default:
             cerr << "[ANOMALY SCORER] Error: unknown execution mode\n";
@@ -916,7 +1427,11 @@ void process_sliding_window_anomalies(const ObservationResultTuple &tuple,
     auto &data =
         context.getLocalStorage().get<SlidingWindowStreamAnomalyScorerData>(
             "data");
-    auto &sliding_window = data.sliding_window_map[tuple.id];
+    if (tuple.id >= data.sliding_windows.size()) {
+        data.sliding_windows.resize(
+            max<size_t>(tuple.id + 1, global_machine_ids.size()));
+    }
+    auto &sliding_window = data.sliding_windows[tuple.id];
 
     sliding_window.push_back(tuple.score);
     if (sliding_window.size() > data.window_length) {
@@ -943,7 +1458,7 @@ void process_sliding_window_anomalies(const ObservationResultTuple &tuple,
 
     data.shipper->push({tuple.id, score_sum, next_ordering_timestamp,
                         tuple.parent_execution_timestamp, tuple.observation,
-                        tuple.score});
+                        tuple.score, tuple.trace.forwarded()});
 }
 
 class SlidingWindowStreamAnomalyScorerFunctor {
@@ -990,12 +1505,11 @@ public:
         case Execution_Mode_t::DEFAULT:
             tuple_queue.push(tuple);
 
-            while (!tuple_queue.empty()
-                   && tuple_queue.top().ordering_timestamp <= watermark) {
-                assert(tuple_queue.top().ordering_timestamp == watermark);
-                process_sliding_window_anomalies(tuple_queue.top(), context);
-                tuple_queue.pop();
-            }
+            tuple_queue.release_until(
+                watermark, [&](const ObservationResultTuple &ready_tuple) {
+                    assert(ready_tuple.ordering_timestamp == watermark);
+                    process_sliding_window_anomalies(ready_tuple, context);
+                });
             break;
         default:
             cerr << "[ANOMALY SCORER] Error: unknown execution mode\n";
@@ -1005,114 +1519,118 @@ public:
     }
 };
 
-template<typename T>
-struct TupleWrapper {
-    T      tuple;
-    double score;
-
-    TupleWrapper(const T &tuple, double score)
-        : tuple {tuple}, score {score} {}
-
-    int compare_to(const TupleWrapper &other) const {
-        if (score == other.score) {
-            return 0;
-        } else if (score > other.score) {
-            return 1;
-        } else {
-            return -1;
-        }
-    }
-};
-
-template<typename T>
-static inline void tuple_swap(vector<TupleWrapper<T>> &tuple_wrapper_list,
-                              size_t left, size_t right) {
-    assert(left <= right);
-    assert(left < tuple_wrapper_list.size());
-    assert(right < tuple_wrapper_list.size());
-
-    if (left != right) {
-        const auto tmp            = move(tuple_wrapper_list[left]);
-        tuple_wrapper_list[left]  = move(tuple_wrapper_list[right]);
-        tuple_wrapper_list[right] = move(tmp);
-    }
-}
-
-template<typename T>
-static inline size_t
-partition_single_side(vector<TupleWrapper<T>> &tuple_wrapper_list, size_t left,
-                      size_t right) {
-    assert(!tuple_wrapper_list.empty());
-    assert(left < right);
-    assert(left < tuple_wrapper_list.size());
-    assert(right < tuple_wrapper_list.size());
-
-    const auto &pivot = tuple_wrapper_list[right];
-    size_t      bar   = left;
+static inline size_t partition_scores(vector<ScoredIndex> &score_list,
+                                      size_t left, size_t right,
+                                      size_t pivot) {
+    assert(left <= pivot && pivot <= right);
+    assert(right < score_list.size());
 
+    swap(score_list[pivot], score_list[right]);
+    size_t bar = left;
     for (size_t i = left; i < right; ++i) {
-        if (tuple_wrapper_list[i].compare_to(pivot) < 0) {
-            tuple_swap(tuple_wrapper_list, bar, i);
+        if (score_list[i] < score_list[right]) {
+            swap(score_list[bar], score_list[i]);
             ++bar;
         }
     }
-    tuple_swap(tuple_wrapper_list, bar, right);
+    swap(score_list[bar], score_list[right]);
     return bar;
 }
 
-template<typename T>
-static inline const TupleWrapper<T> &
-bfprt_wrapper(vector<TupleWrapper<T>> &tuple_wrapper_list, size_t i,
-              size_t left, size_t right) {
-    assert(!tuple_wrapper_list.empty());
-    assert(left <= right);
-    assert(left <= i);
-    assert(i <= right);
-    assert(right < tuple_wrapper_list.size());
-
-    if (left == right) {
-        return tuple_wrapper_list[right];
+static inline size_t get_median_of_three(const vector<ScoredIndex> &score_list,
+                                         size_t a, size_t b, size_t c) {
+    if (score_list[a] < score_list[b]) {
+        if (score_list[b] < score_list[c]) {
+            return b;
+        }
+        return score_list[a] < score_list[c] ? c : a;
+    }
+    if (score_list[a] < score_list[c]) {
+        return a;
     }
+    return score_list[b] < score_list[c] ? c : b;
+}
 
-    const size_t p = partition_single_side(tuple_wrapper_list, left, right);
+static inline void select_score(vector<ScoredIndex> &score_list, size_t left,
+                                size_t right, size_t k,
+                                unsigned depth_budget);
 
-    if (p == i) {
-        return tuple_wrapper_list[p];
-    } else if (p < i) {
-        return bfprt_wrapper(tuple_wrapper_list, i, p + 1, right);
-    } else {
-        assert(p >= 1);
-        return bfprt_wrapper(tuple_wrapper_list, i, left, p - 1);
+/*
+ * BFPRT pivot: moves the medians of groups of five to the front of the
+ * range and selects their median, guaranteeing a balanced partition.
+ */
+static inline size_t get_median_of_medians(vector<ScoredIndex> &score_list,
+                                           size_t left, size_t right) {
+    size_t medians_end = left;
+    for (size_t group = left; group <= right; group += 5) {
+        const size_t group_right = min(group + 4, right);
+        sort(score_list.begin() + group, score_list.begin() + group_right + 1);
+        swap(score_list[medians_end], score_list[(group + group_right) / 2]);
+        ++medians_end;
     }
+
+    const size_t median = left + (medians_end - 1 - left) / 2;
+    select_score(score_list, left, medians_end - 1, median, 0);
+    return median;
 }
 
-static inline AnomalyResultTuple bfprt(vector<AnomalyResultTuple> &tuple_list,
-                                       size_t                      i) {
-    assert(!tuple_list.empty());
-    assert(i < tuple_list.size());
+/*
+ * Introselect: rearranges score_list[left..right] so that its k-th element
+ * is the one sorted order would put there, with smaller elements before it.
+ * Pivots are picked as the median of three until depth_budget partitions
+ * have been spent, then as the median of medians, so that the running time
+ * stays linear in the worst case.
+ */
+static inline void select_score(vector<ScoredIndex> &score_list, size_t left,
+                                size_t right, size_t k,
+                                unsigned depth_budget) {
+    assert(left <= k && k <= right);
+
+    while (left < right) {
+        size_t pivot;
+        if (depth_budget > 0) {
+            --depth_budget;
+            pivot = get_median_of_three(score_list, left,
+                                         left + (right - left) / 2, right);
+        } else {
+            pivot = get_median_of_medians(score_list, left, right);
+        }
 
-    vector<TupleWrapper<AnomalyResultTuple>> tuple_wrapper_list;
-    for (const auto &tuple : tuple_list) {
-        tuple_wrapper_list.emplace_back(tuple, tuple.individual_score);
+        const size_t position =
+            partition_scores(score_list, left, right, pivot);
+        if (position == k) {
+            return;
+        } else if (k < position) {
+            right = position - 1;
+        } else {
+            left = position + 1;
+        }
     }
+}
 
-    const auto &median_tuple =
-        bfprt_wrapper(tuple_wrapper_list, i, 0, tuple_wrapper_list.size() - 1)
-            .tuple;
-    tuple_list.clear();
-
-    for (const auto &wrapper : tuple_wrapper_list) {
-        tuple_list.push_back(wrapper.tuple);
+/*
+ * Fill score_list with the individual scores of stream_list and return the
+ * positions of the streams with the lowest and the median individual score.
+ */
+static inline pair<size_t, size_t>
+get_min_and_median_streams(const vector<AnomalyResultTuple> &stream_list,
+                           vector<ScoredIndex> &             score_list) {
+    assert(!stream_list.empty());
+
+    score_list.clear();
+    for (size_t i = 0; i < stream_list.size(); ++i) {
+        score_list.push_back({stream_list[i].individual_score, i});
     }
 
-    return median_tuple;
-}
+    const size_t median_idx   = score_list.size() / 2;
+    const auto   depth_budget = static_cast<unsigned>(
+        2 * log2(static_cast<double>(score_list.size())));
+    select_score(score_list, 0, score_list.size() - 1, median_idx,
+                 depth_budget);
 
-static inline const vector<AnomalyResultTuple> &
-identify_abnormal_streams(vector<AnomalyResultTuple> &stream_list) {
-    const size_t median_idx {stream_list.size() / 2};
-    bfprt(stream_list, median_idx);
-    return stream_list;
+    const auto min_entry =
+        min_element(score_list.begin(), score_list.begin() + median_idx + 1);
+    return {min_entry->index, score_list[median_idx].index};
 }
 
 void process_alerts(const AnomalyResultTuple &tuple, RuntimeContext &context) {
@@ -1143,12 +1661,10 @@ void process_alerts(const AnomalyResultTuple &tuple, RuntimeContext &context) {
         }
 #endif
         if (!data.stream_list.empty()) {
-            const auto abnormal_streams =
-                identify_abnormal_streams(data.stream_list);
-            const size_t median_idx = data.stream_list.size() / 2;
-            const double min_score  = abnormal_streams[0].anomaly_score;
-
-            assert(median_idx < abnormal_streams.size());
+            const auto &abnormal_streams = data.stream_list;
+            const auto [min_idx, median_idx] =
+                get_min_and_median_streams(abnormal_streams, data.score_list);
+            const double min_score = abnormal_streams[min_idx].anomaly_score;
             const double median_score =
                 abnormal_streams[median_idx].anomaly_score;
 #ifndef NDEBUG
@@ -1180,7 +1696,8 @@ void process_alerts(const AnomalyResultTuple &tuple, RuntimeContext &context) {
                         clog << "[ALERT TRIGGERER "
                              << context.getReplicaIndex()
                              << "] Sending out tuple with stream ID: "
-                             << stream_profile.id
+                             << global_machine_ids.get_name(
+                                    stream_profile.id)
                              << ", stream score: " << stream_score
                              << ", stream profile timestamp: "
                              << stream_profile.ordering_timestamp
@@ -1193,7 +1710,8 @@ void process_alerts(const AnomalyResultTuple &tuple, RuntimeContext &context) {
                     data.shipper->push({stream_profile.id, stream_score,
                                         data.parent_execution_timestamp,
                                         is_abnormal,
-                                        stream_profile.observation});
+                                        stream_profile.observation,
+                                        data.parent_trace.forwarded()});
                 }
             }
             data.stream_list.clear();
@@ -1202,6 +1720,7 @@ void process_alerts(const AnomalyResultTuple &tuple, RuntimeContext &context) {
         }
         data.previous_ordering_timestamp = tuple.ordering_timestamp;
         data.parent_execution_timestamp  = tuple.parent_execution_timestamp;
+        data.parent_trace                = tuple.trace.received();
 #ifndef NDEBUG
         {
             lock_guard lock {print_mutex};
@@ -1258,11 +1777,9 @@ public:
         case Execution_Mode_t::DEFAULT:
             tuple_queue.push(tuple);
 
-            while (!tuple_queue.empty()
-                   && tuple_queue.top().ordering_timestamp <= watermark) {
-                process_alerts(tuple_queue.top(), context);
-                tuple_queue.pop();
-            }
+            tuple_queue.release_until(watermark, [&](const auto &ready_tuple) {
+                process_alerts(ready_tuple, context);
+            });
             break;
         default:
             cerr << "[ALERT TRIGGERER] Error: unknown execution mode\n";
@@ -1293,16 +1810,17 @@ void process_top_k_alerts(const AnomalyResultTuple &tuple,
 #endif
 
     if (tuple.ordering_timestamp > data.previous_ordering_timestamp) {
-        sort(data.stream_list.begin(), data.stream_list.end());
-        const size_t actual_k = data.stream_list.size() < data.k
-                                    ? data.stream_list.size()
-                                    : data.k;
+        data.is_top_k.assign(data.stream_list.size(), false);
+        for (const auto &entry : data.top_k) {
+            data.is_top_k[entry.index] = true;
+        }
         for (size_t i = 0; i < data.stream_list.size(); ++i) {
             auto &     tuple       = data.stream_list[i];
-            const bool is_abnormal = i >= data.stream_list.size() - actual_k;
+            const bool is_abnormal = data.is_top_k[i];
             AlertTriggererResultTuple result {tuple.id, tuple.anomaly_score,
                                               data.parent_execution_timestamp,
-                                              is_abnormal, tuple.observation};
+                                              is_abnormal, tuple.observation,
+                                              data.parent_trace.forwarded()};
 #ifndef NDEBUG
             {
                 lock_guard lock {print_mutex};
@@ -1315,9 +1833,21 @@ void process_top_k_alerts(const AnomalyResultTuple &tuple,
         }
         data.previous_ordering_timestamp = tuple.ordering_timestamp;
         data.parent_execution_timestamp  = tuple.parent_execution_timestamp;
+        data.parent_trace                = tuple.trace.received();
         data.stream_list.clear();
+        data.top_k.clear();
     }
+
+    const ScoredIndex entry {tuple.anomaly_score, data.stream_list.size()};
     data.stream_list.push_back(tuple);
+    if (data.top_k.size() < data.k) {
+        data.top_k.push_back(entry);
+        push_heap(data.top_k.begin(), data.top_k.end(), is_greater_score);
+    } else if (!data.top_k.empty() && data.top_k.front() < entry) {
+        pop_heap(data.top_k.begin(), data.top_k.end(), is_greater_score);
+        data.top_k.back() = entry;
+        push_heap(data.top_k.begin(), data.top_k.end(), is_greater_score);
+    }
 }
 
 class TopKAlertTriggererFunctor {
@@ -1325,7 +1855,7 @@ class TopKAlertTriggererFunctor {
     Execution_Mode_t execution_mode;
 
 public:
-    TopKAlertTriggererFunctor(Execution_Mode_t e, size_t k = 3)
+    TopKAlertTriggererFunctor(Execution_Mode_t e, size_t k)
         : k {k}, execution_mode {e} {}
 
     void operator()(const AnomalyResultTuple &          tuple,
@@ -1346,7 +1876,8 @@ public:
         {
             lock_guard lock {print_mutex};
             clog << "[ALERT TRIGGERER " << context.getReplicaIndex()
-                 << "] Received tuple with id " << tuple.id
+                 << "] Received tuple with id "
+                 << global_machine_ids.get_name(tuple.id)
                  << ", ordering timestamp: " << tuple.ordering_timestamp
                  << ", WindFlow timestamp: " << context.getCurrentTimestamp()
                  << ", current amount of tuples cached: " << tuple_queue.size()
@@ -1360,11 +1891,9 @@ public:
         case Execution_Mode_t::DEFAULT:
             tuple_queue.push(tuple);
 
-            while (!tuple_queue.empty()
-                   && tuple_queue.top().ordering_timestamp <= watermark) {
-                process_top_k_alerts(tuple_queue.top(), context);
-                tuple_queue.pop();
-            }
+            tuple_queue.release_until(watermark, [&](const auto &ready_tuple) {
+                process_top_k_alerts(ready_tuple, context);
+            });
             break;
         default:
             cerr << "[ALERT TRIGGERER] Error: unknown execution mode\n";
@@ -1375,40 +1904,40 @@ public:
 };
 
 class SinkFunctor {
-    vector<unsigned long> latency_samples;
-    unsigned long         tuples_received    = 0;
-    unsigned long         last_sampling_time = current_time();
-    unsigned long         last_arrival_time  = last_sampling_time;
-    unsigned              sampling_rate;
-
-    bool is_time_to_sample(unsigned long arrival_time) {
-        if (sampling_rate == 0) {
-            return true;
-        }
-        const unsigned long time_since_last_sampling =
-            difference(arrival_time, last_sampling_time);
-        const unsigned long time_between_samples =
-            (1.0 / sampling_rate) * timeunit_scale_factor;
-        return time_since_last_sampling >= time_between_samples;
-    }
+    LatencySampler                  latency_samples;
+    HopSamples                      hop_samples;
+    optional<ReplicaCountersHandle> live_counters;
+    unsigned long                   tuples_received   = 0;
+    unsigned long                   last_arrival_time = current_time();
 
 public:
-    SinkFunctor(unsigned rate) : sampling_rate {rate} {}
+    SinkFunctor(const SamplingPolicy &policy) : latency_samples {policy} {}
 
     void operator()(optional<AlertTriggererResultTuple> &input,
                     RuntimeContext &                     context) {
         DO_NOT_WARN_IF_UNUSED(context);
 
+        if (!live_counters) {
+            live_counters = global_live_metrics.add_sink_replica();
+        }
         if (input) {
             const unsigned long arrival_time = current_time();
             const unsigned long latency =
                 difference(arrival_time, input->parent_execution_timestamp);
 
-            ++tuples_received;
+            const bool is_measured =
+                global_measurement_window.contains(arrival_time);
+            if (is_measured) {
+                ++tuples_received;
+                hop_samples.record(input->trace);
+            }
+            live_counters->add_tuples();
             last_arrival_time = arrival_time;
-            if (is_time_to_sample(arrival_time)) {
-                latency_samples.push_back(latency);
-                last_sampling_time = arrival_time;
+            if (latency_samples.should_sample(arrival_time)) {
+                if (is_measured) {
+                    latency_samples.record(latency);
+                }
+                live_counters->record_latency(latency);
             }
 #ifndef NDEBUG
             {
@@ -1427,7 +1956,8 @@ public:
 #endif
         } else {
             global_received_tuples.fetch_add(tuples_received);
-            global_latency_metric.merge(latency_samples);
+            global_latency_metric.merge(latency_samples.get_samples());
+            global_hop_tracer.merge(hop_samples);
         }
     }
 };
@@ -1435,11 +1965,14 @@ public:
 static MultiPipe &get_source_pipe(const Parameters &parameters,
                                   PipeGraph &       graph) {
     const string name = parameters.parser_type;
+    const auto   load_profile = get_load_profile_from_string(
+        parameters.load_profile, parameters.tuple_rate, parameters.duration);
 
     if (name == "alibaba") {
         SourceFunctor<MachineMetadata, parse_alibaba_trace> source_functor {
-            parameters.duration, parameters.tuple_rate,
-            parameters.execution_mode, parameters.input_file};
+            parameters.duration, load_profile, parameters.execution_mode,
+            parameters.use_open_loop,
+            parameters.input_file};
 
         const auto source =
             Source_Builder {source_functor}
@@ -1450,8 +1983,9 @@ static MultiPipe &get_source_pipe(const Parameters &parameters,
         return graph.add_source(source);
     } else if (name == "google") {
         SourceFunctor<MachineMetadata, parse_google_trace> source_functor {
-            parameters.duration, parameters.tuple_rate,
-            parameters.execution_mode, parameters.input_file};
+            parameters.duration, load_profile, parameters.execution_mode,
+            parameters.use_open_loop,
+            parameters.input_file};
 
         const auto source =
             Source_Builder {source_functor}
@@ -1472,15 +2006,18 @@ static MultiPipe &get_anomaly_scorer_pipe(const Parameters &parameters,
     const bool   use_chaining = parameters.use_chaining;
 
     if (name == "data-stream" || name == "data_stream") {
-        DataStreamAnomalyScorerFunctor<MachineMetadata>
-                   anomaly_scorer_functor {parameters.execution_mode};
+        InstrumentedFunctor anomaly_scorer_functor {
+            DataStreamAnomalyScorerFunctor<MachineMetadata> {
+                parameters.execution_mode},
+            "anomaly scorer", global_operator_stats};
         const auto anomaly_scorer_node =
             FlatMap_Builder {anomaly_scorer_functor}
                 .withParallelism(parameters.parallelism[anomaly_scorer_id])
                 .withName("anomaly scorer")
-                .withKeyBy([](const ObservationResultTuple &tuple) -> string {
-                    return tuple.id;
-                })
+                .withKeyBy(
+                    [](const ObservationResultTuple &tuple) -> MachineId {
+                        return tuple.id;
+                    })
                 .withOutputBatchSize(parameters.batch_size[anomaly_scorer_id])
                 .withClosingFunction(
                     function<void(RuntimeContext &)> {process_last_tuples<
@@ -1491,15 +2028,18 @@ static MultiPipe &get_anomaly_scorer_pipe(const Parameters &parameters,
         return use_chaining ? pipe.chain(anomaly_scorer_node)
                             : pipe.add(anomaly_scorer_node);
     } else if (name == "sliding-window" || name == "sliding_window") {
-        SlidingWindowStreamAnomalyScorerFunctor anomaly_scorer_functor {
-            parameters.execution_mode};
+        InstrumentedFunctor anomaly_scorer_functor {
+            SlidingWindowStreamAnomalyScorerFunctor {
+                parameters.execution_mode},
+            "anomaly scorer", global_operator_stats};
         const auto anomaly_scorer_node =
             FlatMap_Builder {anomaly_scorer_functor}
                 .withParallelism(parameters.parallelism[anomaly_scorer_id])
                 .withName("anomaly scorer")
-                .withKeyBy([](const ObservationResultTuple &tuple) -> string {
-                    return tuple.id;
-                })
+                .withKeyBy(
+                    [](const ObservationResultTuple &tuple) -> MachineId {
+                        return tuple.id;
+                    })
                 .withOutputBatchSize(parameters.batch_size[anomaly_scorer_id])
                 .withClosingFunction(function<void(RuntimeContext &)> {
                     process_last_tuples<SlidingWindowStreamAnomalyScorerData,
@@ -1521,8 +2061,10 @@ static MultiPipe &get_alert_triggerer_pipe(const Parameters &parameters,
     const bool   use_chaining = parameters.use_chaining;
 
     if (name == "top-k" || name == "top_k") {
-        TopKAlertTriggererFunctor alert_triggerer_functor {
-            parameters.execution_mode};
+        InstrumentedFunctor alert_triggerer_functor {
+            TopKAlertTriggererFunctor {parameters.execution_mode,
+                                       parameters.top_k},
+            "alert triggerer", global_operator_stats};
         const auto alert_triggerer_node =
             FlatMap_Builder {alert_triggerer_functor}
                 .withParallelism(parameters.parallelism[alert_triggerer_id])
@@ -1536,8 +2078,9 @@ static MultiPipe &get_alert_triggerer_pipe(const Parameters &parameters,
         return use_chaining ? pipe.chain(alert_triggerer_node)
                             : pipe.add(alert_triggerer_node);
     } else if (name == "default") {
-        AlertTriggererFunctor alert_triggerer_functor {
-            parameters.execution_mode};
+        InstrumentedFunctor alert_triggerer_functor {
+            AlertTriggererFunctor {parameters.execution_mode},
+            "alert triggerer", global_operator_stats};
         const auto alert_triggerer_node =
             FlatMap_Builder {alert_triggerer_functor}
                 .withParallelism(parameters.parallelism[alert_triggerer_id])
@@ -1557,26 +2100,50 @@ static MultiPipe &get_alert_triggerer_pipe(const Parameters &parameters,
     }
 }
 
-static inline PipeGraph &build_graph(const Parameters &parameters,
-                                     PipeGraph &       graph) {
-    auto &source_pipe = get_source_pipe(parameters, graph);
-
-    ObservationScorerFunctor<MachineMetadataScorer> observer_functor {
-        parameters.execution_mode};
+template<typename Scorer>
+static inline MultiPipe &add_observation_scorer(const Parameters &parameters,
+                                                MultiPipe &       pipe) {
+    InstrumentedFunctor observer_functor {
+        ObservationScorerFunctor<Scorer> {parameters.execution_mode},
+        "observation scorer", global_operator_stats};
     const auto observer_scorer_node =
         FlatMap_Builder {observer_functor}
             .withParallelism(parameters.parallelism[observer_id])
             .withName("observation scorer")
             .withOutputBatchSize(parameters.batch_size[observer_id])
-            .withClosingFunction(
-                function<void(RuntimeContext &)> {process_last_tuples<
-                    ObservationScorerData<MachineMetadataScorer>, SourceTuple,
-                    process_observations<MachineMetadataScorer>>})
+            .withClosingFunction(function<void(RuntimeContext &)> {
+                process_last_tuples<ObservationScorerData<Scorer>, SourceTuple,
+                                    process_observations<Scorer>>})
             .build();
 
+    return parameters.use_chaining ? pipe.chain(observer_scorer_node)
+                                   : pipe.add(observer_scorer_node);
+}
+
+static MultiPipe &get_observation_scorer_pipe(const Parameters &parameters,
+                                              MultiPipe &       pipe) {
+    const string name = parameters.observation_scorer_type;
+
+    if (name == "columnar") {
+        return add_observation_scorer<
+            ColumnarMachineMetadataScorer<feature_count>>(parameters, pipe);
+    } else if (name == "valarray") {
+        return add_observation_scorer<MachineMetadataScorer>(parameters,
+                                                             pipe);
+    } else {
+        cerr << "Error while building graph: unknown Observation Scorer "
+                "type: "
+             << name << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline PipeGraph &build_graph(const Parameters &parameters,
+                                     PipeGraph &       graph) {
+    auto &source_pipe = get_source_pipe(parameters, graph);
+
     auto &observation_scorer_pipe =
-        parameters.use_chaining ? source_pipe.chain(observer_scorer_node)
-                                : source_pipe.add(observer_scorer_node);
+        get_observation_scorer_pipe(parameters, source_pipe);
 
     auto &anomaly_scorer_pipe =
         get_anomaly_scorer_pipe(parameters, observation_scorer_pipe);
@@ -1584,11 +2151,15 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
     auto &alert_triggerer_pipe =
         get_alert_triggerer_pipe(parameters, anomaly_scorer_pipe);
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink = Sink_Builder {sink_functor}
-                          .withParallelism(parameters.parallelism[sink_id])
-                          .withName("sink")
-                          .build();
+    InstrumentedFunctor sink_functor {
+        SinkFunctor {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink =
+        Sink_Builder {sink_functor}
+            .withParallelism(parameters.parallelism[sink_id])
+            .withName("sink")
+            .build();
 
     if (parameters.use_chaining) {
         alert_triggerer_pipe.chain_sink(sink);
@@ -1604,8 +2175,12 @@ add_mo_stats(const nlohmann::ordered_json &json_stats,
              const Parameters &            parameters) {
     auto updated_json_stats = json_stats;
 
-    updated_json_stats["anomaly scorer"]  = parameters.anomaly_scorer_type;
-    updated_json_stats["alert triggerer"] = parameters.alert_triggerer_type;
+    updated_json_stats["observation scorer"] =
+        parameters.observation_scorer_type;
+    updated_json_stats["features"]           = feature_count;
+    updated_json_stats["anomaly scorer"]     = parameters.anomaly_scorer_type;
+    updated_json_stats["alert triggerer"]    = parameters.alert_triggerer_type;
+    updated_json_stats["top k"]              = parameters.top_k;
     return updated_json_stats;
 }
 #endif
@@ -1620,14 +2195,45 @@ int main(int argc, char *argv[]) {
     build_graph(parameters, graph);
     print_initial_parameters(parameters);
 
+    global_thread_placement.assign("source", parameters.affinity[source_id]);
+    global_thread_placement.assign("observation scorer",
+                                   parameters.affinity[observer_id]);
+    global_thread_placement.assign("anomaly scorer",
+                                   parameters.affinity[anomaly_scorer_id]);
+    global_thread_placement.assign("alert triggerer",
+                                   parameters.affinity[alert_triggerer_id]);
+    global_thread_placement.assign("sink", parameters.affinity[sink_id]);
+
+    if (parameters.live_interval > 0) {
+        global_live_metrics.start(parameters.live_interval, "mo-live",
+                                  parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        global_operator_stats.enable(parameters.collect_perf_counters);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.enable(
+            get_sampling_policy_from_string(parameters.sampling_policy,
+                                            parameters.sampling_rate),
+            "mo");
+    }
+
+    global_measurement_window.start(
+        get_warmup_from_string(parameters.warmup, parameters.duration),
+        parameters.duration, global_live_metrics);
     const unsigned long start_time = current_time();
     graph.run();
     const unsigned long elapsed_time = difference(current_time(), start_time);
+    global_measurement_window.stop();
+    global_live_metrics.stop();
+    const unsigned long measured_time =
+        global_measurement_window.get_measured_time();
 
 #if defined(NDEBUG) && !defined(PROFILE)
     const double throughput =
-        elapsed_time > 0
-            ? (global_sent_tuples.load() / static_cast<double>(elapsed_time))
+        measured_time > 0
+            ? (global_sent_tuples.load() / static_cast<double>(measured_time))
             : global_sent_tuples.load();
 
     const double service_time = 1 / throughput;
@@ -1652,14 +2258,28 @@ int main(int argc, char *argv[]) {
         parameters);
     serialize_json(service_time_stats, "mo-service-time",
                    parameters.metric_output_directory);
+
+    if (parameters.use_open_loop) {
+        const auto schedule_lag_stats = get_distribution_stats(
+            global_schedule_lag_metric, parameters, global_sent_tuples);
+        serialize_json(schedule_lag_stats, "mo-schedule-lag",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        const auto operator_stats = get_operator_stats(
+            global_operator_stats, "mo-operators", parameters);
+        serialize_json(operator_stats, "mo-operators",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.serialize(parameters);
+    }
 #endif
 
-    const double average_latency =
-        accumulate(global_latency_metric.begin(), global_latency_metric.end(),
-                   0.0)
-        / (!global_latency_metric.empty() ? global_latency_metric.size()
-                                          : 1.0);
-    print_statistics(elapsed_time, parameters.duration, global_sent_tuples,
-                     average_latency, global_received_tuples);
+    const double average_latency = global_latency_metric.mean();
+    print_statistics(elapsed_time, measured_time, parameters.duration,
+                     global_sent_tuples, average_latency,
+                     global_received_tuples);
     return 0;
 }
@@ -82,10 +82,19 @@ struct Parameters {
     Time_Policy_t    time_policy                = Time_Policy_t::INGRESS_TIME;
     unsigned         parallelism[num_nodes]     = {1, 1, 1, 1};
     unsigned         batch_size[num_nodes - 1]  = {0, 0, 0};
+    vector<unsigned> affinity[num_nodes];
     unsigned         duration                   = 60;
     unsigned         tuple_rate                 = 0;
     unsigned         sampling_rate              = 100;
+    unsigned         live_interval              = 0;
     bool             use_chaining               = false;
+    bool             collect_operator_stats     = false;
+    bool             use_tracing                = false;
+    bool             collect_perf_counters      = false;
+    const char *     sampling_policy            = "time";
+    const char *     warmup                     = "none";
+    const char *     load_profile               = "constant";
+    bool             use_open_loop              = false;
 };
 
 struct InputTuple {
@@ -94,12 +103,14 @@ struct InputTuple {
     unsigned long value;
     unsigned long timestamp;
     unsigned      reinforcement_learner_target_replica;
+    TupleTrace    trace {};
 };
 
 struct OutputTuple {
     vector<string> actions;
     string         event_id;
     unsigned long  timestamp;
+    TupleTrace     trace {};
 };
 
 static const struct option long_opts[] = {{"help", 0, 0, 'h'},
@@ -112,7 +123,16 @@ static const struct option long_opts[] = {{"help", 0, 0, 'h'},
                                           {"outputdir", 1, 0, 'o'},
                                           {"execmode", 1, 0, 'e'},
                                           {"timepolicy", 1, 0, 't'},
+                                          {"liveinterval", 1, 0, 'i'},
+                                          {"operatorstats", 1, 0, 'O'},
                                           {"reinforcementlearner", 1, 0, 'R'},
+                                          {"openloop", 1, 0, 'l'},
+                                          {"profile", 1, 0, 'L'},
+                                          {"warmup", 1, 0, 'w'},
+                                          {"samplingpolicy", 1, 0, 'S'},
+                                          {"perfcounters", 1, 0, 'C'},
+                                          {"affinity", 1, 0, 'A'},
+                                          {"tracing", 1, 0, 'H'},
                                           {0, 0, 0, 0}};
 
 static const vector<string> default_available_actions {"page1", "page2",
@@ -181,7 +201,8 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
     int option;
     int index;
 
-    while ((option = getopt_long(argc, argv, "r:s:p:b:c:d:o:e:t:R:h",
+    while ((option = getopt_long(argc, argv,
+                                 "r:s:p:b:c:d:o:e:t:i:O:R:l:L:w:S:C:A:H:h",
                                  long_opts, &index))
            != -1) {
         switch (option) {
@@ -217,6 +238,19 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
                 }
             }
         } break;
+        case 'A': {
+            const auto core_lists = get_affinity_from_string(optarg);
+            if (core_lists.size() != num_nodes) {
+                cerr << "Error in parsing the input arguments.  Affinity "
+                        "string requires exactly "
+                     << num_nodes << " core lists.\n";
+                exit(EXIT_FAILURE);
+            } else {
+                for (unsigned i = 0; i < num_nodes; ++i) {
+                    parameters.affinity[i] = core_lists[i];
+                }
+            }
+        } break;
         case 'c':
             parameters.use_chaining = get_bool_from_string(optarg);
             break;
@@ -232,15 +266,47 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
         case 't':
             parameters.time_policy = get_time_policy_from_string(optarg);
             break;
+        case 'i':
+            parameters.live_interval = atoi(optarg);
+            break;
+        case 'O':
+            parameters.collect_operator_stats = get_bool_from_string(optarg);
+            break;
         case 'R':
             parameters.reinforcement_learner_type = optarg;
             break;
+        case 'l':
+            parameters.use_open_loop = get_bool_from_string(optarg);
+            break;
+        case 'L':
+            parameters.load_profile = optarg;
+            break;
+        case 'w':
+            parameters.warmup = optarg;
+            break;
+        case 'S':
+            parameters.sampling_policy = optarg;
+            break;
+        case 'C':
+            parameters.collect_perf_counters = get_bool_from_string(optarg);
+            break;
+        case 'H':
+            parameters.use_tracing = get_bool_from_string(optarg);
+            break;
         case 'h':
             cout << "Parameters: --rate <value> --sampling "
                     "<value> --batch <size> --parallelism "
                     "<nEventSource,nRewardSource,nReinforcementLearner,nSink> "
                     "[--duration <seconds>] "
-                    "[--chaining <value>]\n";
+                    "[--chaining <value>] [--liveinterval <msec>] "
+                    "[--operatorstats <value>] "
+                    "[--openloop <value>] "
+                    "[--profile <shape[,argument...]>] "
+                    "[--warmup <mode[,argument]>] "
+                    "[--samplingpolicy <policy[,argument]>] "
+                    "[--perfcounters <value>] "
+                    "[--affinity <cores,cores,...>] "
+                    "[--tracing <value>]\n";
             exit(EXIT_SUCCESS);
             break;
         default:
@@ -265,6 +331,29 @@ static void validate_args(const Parameters &parameters) {
             exit(EXIT_FAILURE);
         }
     }
+
+    if (parameters.use_open_loop && parameters.tuple_rate == 0) {
+        cerr << "Error: open-loop generation requires a positive tuple "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (string {parameters.load_profile} != "constant"
+        && parameters.tuple_rate == 0) {
+        cerr << "Error: load profiles other than constant need a positive "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+    if (parameters.tuple_rate > 0) {
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration);
+    }
+
+    get_warmup_from_string(parameters.warmup, parameters.duration);
+
+    get_sampling_policy_from_string(parameters.sampling_policy,
+                                    parameters.sampling_rate);
 }
 
 static void print_initial_parameters(const Parameters &parameters) {
@@ -314,6 +403,40 @@ static void print_initial_parameters(const Parameters &parameters) {
          << '\n'
          << "Reinforcement Learner type: "
          << parameters.reinforcement_learner_type << '\n';
+
+    cout << "Live metrics interval:\t";
+    if (parameters.live_interval > 0) {
+        cout << parameters.live_interval << " ms\n";
+    } else {
+        cout << "disabled\n";
+    }
+
+    cout << "Per-operator statistics:\t"
+         << (parameters.collect_operator_stats ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Open-loop generation:\t"
+         << (parameters.use_open_loop ? "enabled" : "disabled") << '\n';
+
+    cout << "Load profile:\t" << parameters.load_profile << '\n';
+
+    cout << "Warm-up:\t" << parameters.warmup << '\n';
+
+    cout << "Sampling policy:\t" << parameters.sampling_policy << '\n';
+
+    cout << "Performance counters:\t"
+         << (parameters.collect_perf_counters ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Affinity:\t";
+    for (unsigned i = 0; i < num_nodes; ++i) {
+        cout << (i > 0 ? "," : "")
+             << get_string_from_core_list(parameters.affinity[i]);
+    }
+    cout << '\n';
+
+    cout << "Per-hop tracing:\t"
+         << (parameters.use_tracing ? "enabled" : "disabled") << '\n';
 }
 
 /*
@@ -322,7 +445,10 @@ static void print_initial_parameters(const Parameters &parameters) {
 static atomic_ulong             global_sent_tuples {0};
 static atomic_ulong             global_received_tuples {0};
 static Metric<unsigned long>    global_latency_metric {"rl-latency"};
+static Metric<unsigned long>    global_schedule_lag_metric {"rl-schedule-lag"};
 static NonBlockingQueue<string> global_action_queue;
+static LiveMetricsReporter      global_live_metrics;
+static OperatorStatsRegistry    global_operator_stats;
 #ifndef NDEBUG
 static mutex print_mutex;
 #endif
@@ -331,6 +457,8 @@ class CTRGeneratorFunctor {
     UUIDGenerator uuid_gen;
     unsigned long duration;
     unsigned      tuple_rate_per_second;
+    LoadProfile   load_profile;
+    bool          open_loop;
 
     unsigned long round_num   = 1;
     unsigned long event_count = 0;
@@ -339,7 +467,7 @@ class CTRGeneratorFunctor {
     unsigned reinforcement_learner_replicas;
     unsigned current_reinforcement_learner_target_replica = 0;
 
-    InputTuple get_new_tuple() {
+    InputTuple get_new_tuple(unsigned long timestamp, TupleTrace trace) {
         const auto session_id = uuid_gen();
         ++round_num;
         ++event_count;
@@ -355,36 +483,60 @@ class CTRGeneratorFunctor {
             }
         }
 #endif
-        const unsigned long timestamp = current_time();
         return {InputTuple::Event, session_id, round_num, timestamp,
-                current_reinforcement_learner_target_replica};
+                current_reinforcement_learner_target_replica, move(trace)};
     }
 
 public:
-    CTRGeneratorFunctor(unsigned long d, unsigned rate,
-                        unsigned      reinforcement_learner_replicas,
-                        unsigned long max_rounds = 10000)
-        : duration {d * timeunit_scale_factor}, tuple_rate_per_second {rate},
-          max_rounds {max_rounds}, reinforcement_learner_replicas {
-                                       reinforcement_learner_replicas} {}
-
-    void operator()(Source_Shipper<InputTuple> &shipper) {
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
-
-        while (current_time() < end_time) {
-            shipper.push(get_new_tuple());
+    CTRGeneratorFunctor(unsigned long      d, const LoadProfile &profile,
+                        unsigned           reinforcement_learner_replicas,
+                        bool               open_loop  = false,
+                        unsigned long      max_rounds = 10000)
+        : duration {d * timeunit_scale_factor},
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile}, open_loop {open_loop},
+          max_rounds {max_rounds},
+          reinforcement_learner_replicas {reinforcement_learner_replicas} {}
+
+    void operator()(Source_Shipper<InputTuple> &shipper,
+                    RuntimeContext &            context) {
+        global_thread_placement.pin_current_thread("ctr generator",
+                                                   context.getReplicaIndex());
+
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
+        TraceSampler        trace_sampler;
+
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, open_loop);
+        }
+
+        while (!deadline.has_expired()) {
+            const unsigned long timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
+            auto trace = trace_sampler.start_trace(timestamp);
+            shipper.push(get_new_tuple(timestamp, move(trace)));
             current_reinforcement_learner_target_replica =
                 (current_reinforcement_learner_target_replica + 1)
                 % reinforcement_learner_replicas;
-            ++sent_tuples;
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            if (global_measurement_window.contains(timestamp)) {
+                ++sent_tuples;
+            } else {
+                ++excluded_tuples;
             }
+            live_counters.add_tuples();
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
+        if (open_loop) {
+            global_schedule_lag_metric.merge(
+                rate_controller->get_lag_samples());
+        }
     }
 };
 
@@ -397,6 +549,7 @@ class RewardSourceFunctor {
     uniform_int_distribution<int> rand {1, 101};
     unsigned long                 duration;
     unsigned                      tuple_rate_per_second;
+    LoadProfile                   load_profile;
     unsigned                      reinforcement_learner_replicas;
 
     void send_new_reward(Source_Shipper<InputTuple> &shipper) {
@@ -457,26 +610,45 @@ class RewardSourceFunctor {
     }
 
 public:
-    RewardSourceFunctor(unsigned d, unsigned rate, unsigned rl_replicas)
-        : duration {d * timeunit_scale_factor}, tuple_rate_per_second {rate},
+    RewardSourceFunctor(unsigned d, const LoadProfile &profile,
+                        unsigned rl_replicas)
+        : duration {d * timeunit_scale_factor},
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile},
           reinforcement_learner_replicas {rl_replicas} {
         assert(rl_replicas != 0);
     }
 
-    void operator()(Source_Shipper<InputTuple> &shipper) {
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
+    void operator()(Source_Shipper<InputTuple> &shipper,
+                    RuntimeContext &            context) {
+        global_thread_placement.pin_current_thread("reward source",
+                                                   context.getReplicaIndex());
+
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
 
-        while (current_time() < end_time) {
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, false);
+        }
+
+        while (!deadline.has_expired()) {
+            const unsigned long timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
             send_new_reward(shipper);
-            ++sent_tuples;
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            if (global_measurement_window.contains(timestamp)) {
+                ++sent_tuples;
+            } else {
+                ++excluded_tuples;
             }
+            live_counters.add_tuples();
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
     }
 };
 
@@ -1053,7 +1225,8 @@ public:
                 clog << '\n';
             }
 #endif
-            shipper.push({actions, event_id, tuple.timestamp});
+            shipper.push(
+                {actions, event_id, tuple.timestamp, tuple.trace.forwarded()});
         } break;
         case InputTuple::Reward: {
             const auto &action_id = tuple.id;
@@ -1075,27 +1248,19 @@ public:
 };
 
 class SinkFunctor {
-    vector<unsigned long> latency_samples;
-    unsigned long         tuples_received    = 0;
-    unsigned long         last_sampling_time = current_time();
-    unsigned long         last_arrival_time  = last_sampling_time;
-    unsigned              sampling_rate;
-
-    bool is_time_to_sample(unsigned long arrival_time) {
-        if (sampling_rate == 0) {
-            return true;
-        }
-        const unsigned long time_since_last_sampling =
-            difference(arrival_time, last_sampling_time);
-        const unsigned long time_between_samples =
-            (1.0 / sampling_rate) * timeunit_scale_factor;
-        return time_since_last_sampling >= time_between_samples;
-    }
+    LatencySampler                  latency_samples;
+    HopSamples                      hop_samples;
+    optional<ReplicaCountersHandle> live_counters;
+    unsigned long                   tuples_received   = 0;
+    unsigned long                   last_arrival_time = current_time();
 
 public:
-    SinkFunctor(unsigned rate) : sampling_rate {rate} {}
+    SinkFunctor(const SamplingPolicy &policy) : latency_samples {policy} {}
 
     void operator()(optional<OutputTuple> &input) {
+        if (!live_counters) {
+            live_counters = global_live_metrics.add_sink_replica();
+        }
         if (input) {
 #ifndef NDEBUG
             {
@@ -1117,15 +1282,24 @@ public:
             const unsigned long latency =
                 difference(arrival_time, input->timestamp);
 
-            ++tuples_received;
+            const bool is_measured =
+                global_measurement_window.contains(arrival_time);
+            if (is_measured) {
+                ++tuples_received;
+                hop_samples.record(input->trace);
+            }
+            live_counters->add_tuples();
             last_arrival_time = arrival_time;
-            if (is_time_to_sample(arrival_time)) {
-                latency_samples.push_back(latency);
-                last_sampling_time = arrival_time;
+            if (latency_samples.should_sample(arrival_time)) {
+                if (is_measured) {
+                    latency_samples.record(latency);
+                }
+                live_counters->record_latency(latency);
             }
         } else {
             global_received_tuples.fetch_add(tuples_received);
-            global_latency_metric.merge(latency_samples);
+            global_latency_metric.merge(latency_samples.get_samples());
+            global_hop_tracer.merge(hop_samples);
         }
     }
 };
@@ -1136,8 +1310,10 @@ static MultiPipe &get_reinforcement_learner_pipe(const Parameters &parameters,
     const bool   use_chaining = parameters.use_chaining;
 
     if (name == "interval-estimator") {
-        ReinforcementLearnerFunctor<IntervalEstimator>
-                   reinforcement_learner_functor {default_available_actions};
+        InstrumentedFunctor reinforcement_learner_functor {
+            ReinforcementLearnerFunctor<IntervalEstimator> {
+                default_available_actions},
+            "reinforcement learner", global_operator_stats};
         const auto reinforcement_learner_node =
             FlatMap_Builder {reinforcement_learner_functor}
                 .withParallelism(
@@ -1152,8 +1328,10 @@ static MultiPipe &get_reinforcement_learner_pipe(const Parameters &parameters,
         return use_chaining ? pipe.chain(reinforcement_learner_node)
                             : pipe.add(reinforcement_learner_node);
     } else if (name == "sampson") {
-        ReinforcementLearnerFunctor<SampsonSampler>
-                   reinforcement_learner_functor {default_available_actions};
+        InstrumentedFunctor reinforcement_learner_functor {
+            ReinforcementLearnerFunctor<SampsonSampler> {
+                default_available_actions},
+            "reinforcement learner", global_operator_stats};
         const auto reinforcement_learner_node =
             FlatMap_Builder {reinforcement_learner_functor}
                 .withParallelism(
@@ -1168,8 +1346,10 @@ static MultiPipe &get_reinforcement_learner_pipe(const Parameters &parameters,
         return use_chaining ? pipe.chain(reinforcement_learner_node)
                             : pipe.add(reinforcement_learner_node);
     } else if (name == "optimistic-sampson") {
-        ReinforcementLearnerFunctor<OptimisticSampsonSampler>
-                   reinforcement_learner_functor {default_available_actions};
+        InstrumentedFunctor reinforcement_learner_functor {
+            ReinforcementLearnerFunctor<OptimisticSampsonSampler> {
+                default_available_actions},
+            "reinforcement learner", global_operator_stats};
         const auto reinforcement_learner_node =
             FlatMap_Builder {reinforcement_learner_functor}
                 .withParallelism(
@@ -1184,8 +1364,10 @@ static MultiPipe &get_reinforcement_learner_pipe(const Parameters &parameters,
         return use_chaining ? pipe.chain(reinforcement_learner_node)
                             : pipe.add(reinforcement_learner_node);
     } else if (name == "random" || name == "random-greedy") {
-        ReinforcementLearnerFunctor<RandomGreedyLearner>
-                   reinforcement_learner_functor {default_available_actions};
+        InstrumentedFunctor reinforcement_learner_functor {
+            ReinforcementLearnerFunctor<RandomGreedyLearner> {
+                default_available_actions},
+            "reinforcement learner", global_operator_stats};
         const auto reinforcement_learner_node =
             FlatMap_Builder {reinforcement_learner_functor}
                 .withParallelism(
@@ -1209,9 +1391,13 @@ static MultiPipe &get_reinforcement_learner_pipe(const Parameters &parameters,
 
 static inline PipeGraph &build_graph(const Parameters &parameters,
                                      PipeGraph &       graph) {
+    const auto load_profile = get_load_profile_from_string(
+        parameters.load_profile, parameters.tuple_rate, parameters.duration);
+
     CTRGeneratorFunctor ctr_generator_functor {
-        parameters.duration, parameters.tuple_rate,
-        parameters.parallelism[reinforcement_learner_id]};
+        parameters.duration, load_profile,
+        parameters.parallelism[reinforcement_learner_id],
+        parameters.use_open_loop};
     const auto ctr_generator_node =
         Source_Builder {
             ctr_generator_functor,
@@ -1222,7 +1408,7 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
             .build();
 
     RewardSourceFunctor reward_source_functor {
-        parameters.duration, parameters.tuple_rate,
+        parameters.duration, load_profile,
         parameters.parallelism[reinforcement_learner_id]};
     const auto reward_source_node =
         Source_Builder {reward_source_functor}
@@ -1231,11 +1417,15 @@ static inline PipeGraph &build_graph(const Parameters &parameters,
             .withOutputBatchSize(parameters.batch_size[reward_source_id])
             .build();
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink = Sink_Builder {sink_functor}
-                          .withParallelism(parameters.parallelism[sink_id])
-                          .withName("sink")
-                          .build();
+    InstrumentedFunctor sink_functor {
+        SinkFunctor {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink =
+        Sink_Builder {sink_functor}
+            .withParallelism(parameters.parallelism[sink_id])
+            .withName("sink")
+            .build();
 
     auto &ctr_generator_pipe = graph.add_source(ctr_generator_node);
     auto &reward_source_pipe = graph.add_source(reward_source_node);
@@ -1270,14 +1460,45 @@ int main(int argc, char *argv[]) {
     build_graph(parameters, graph);
     print_initial_parameters(parameters);
 
+    global_thread_placement.assign("ctr generator",
+                                   parameters.affinity[ctr_generator_id]);
+    global_thread_placement.assign("reward source",
+                                   parameters.affinity[reward_source_id]);
+    global_thread_placement.assign(
+        "reinforcement learner",
+        parameters.affinity[reinforcement_learner_id]);
+    global_thread_placement.assign("sink", parameters.affinity[sink_id]);
+
+    if (parameters.live_interval > 0) {
+        global_live_metrics.start(parameters.live_interval, "rl-live",
+                                  parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        global_operator_stats.enable(parameters.collect_perf_counters);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.enable(
+            get_sampling_policy_from_string(parameters.sampling_policy,
+                                            parameters.sampling_rate),
+            "rl");
+    }
+
+    global_measurement_window.start(
+        get_warmup_from_string(parameters.warmup, parameters.duration),
+        parameters.duration, global_live_metrics);
     const unsigned long start_time = current_time();
     graph.run();
     const unsigned long elapsed_time = difference(current_time(), start_time);
+    global_measurement_window.stop();
+    global_live_metrics.stop();
+    const unsigned long measured_time =
+        global_measurement_window.get_measured_time();
 
 #if defined(NDEBUG) && !defined(PROFILE)
     const double throughput =
-        elapsed_time > 0
-            ? (global_sent_tuples.load() / static_cast<double>(elapsed_time))
+        measured_time > 0
+            ? (global_sent_tuples.load() / static_cast<double>(measured_time))
             : global_sent_tuples.load();
 
     const double service_time = 1 / throughput;
@@ -1302,14 +1523,28 @@ int main(int argc, char *argv[]) {
         parameters);
     serialize_json(service_time_stats, "rl-service-time",
                    parameters.metric_output_directory);
+
+    if (parameters.use_open_loop) {
+        const auto schedule_lag_stats = get_distribution_stats(
+            global_schedule_lag_metric, parameters, global_sent_tuples);
+        serialize_json(schedule_lag_stats, "rl-schedule-lag",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        const auto operator_stats = get_operator_stats(
+            global_operator_stats, "rl-operators", parameters);
+        serialize_json(operator_stats, "rl-operators",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.serialize(parameters);
+    }
 #endif
 
-    const double average_latency =
-        accumulate(global_latency_metric.begin(), global_latency_metric.end(),
-                   0.0)
-        / (!global_latency_metric.empty() ? global_latency_metric.size()
-                                          : 1.0);
-    print_statistics(elapsed_time, parameters.duration, global_sent_tuples,
-                     average_latency, global_received_tuples);
+    const double average_latency = global_latency_metric.mean();
+    print_statistics(elapsed_time, measured_time, parameters.duration,
+                     global_sent_tuples, average_latency,
+                     global_received_tuples);
     return 0;
 }
@@ -11,13 +11,20 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <getopt.h>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <numeric>
@@ -29,7 +36,12 @@
 #include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "../util.hpp"
+#include "afinn-111.hpp"
 
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -67,10 +79,17 @@ using namespace wf;
 enum NodeId : unsigned {
     source_id     = 0,
     classifier_id = 1,
-    sink_id       = 2,
-    num_nodes     = 3
+    aggregator_id = 2,
+    sink_id       = 3,
+    num_nodes     = 4
 };
 
+/*
+ * Number of classes of the linear classifier by default, and at most.
+ */
+static constexpr unsigned default_classifier_classes = 256;
+static constexpr unsigned max_classifier_classes     = 4096;
+
 /*
  * This struct holds every command line parameter.
  */
@@ -78,12 +97,29 @@ struct Parameters {
     const char *     metric_output_directory   = ".";
     Execution_Mode_t execution_mode            = Execution_Mode_t::DEFAULT;
     Time_Policy_t    time_policy               = Time_Policy_t::INGRESS_TIME;
-    unsigned         parallelism[num_nodes]    = {1, 1, 1};
-    unsigned         batch_size[num_nodes - 1] = {0, 0};
+    unsigned         parallelism[num_nodes]    = {1, 1, 1, 1};
+    unsigned         batch_size[num_nodes - 1] = {0, 0, 0};
+    vector<unsigned> affinity[num_nodes];
     unsigned         duration                  = 60;
     unsigned         tuple_rate                = 0;
     unsigned         sampling_rate             = 100;
+    unsigned         live_interval             = 0;
     bool             use_chaining              = false;
+    bool             collect_operator_stats    = false;
+    unsigned         tweets_per_tuple          = 1;
+    bool             use_streaming             = false;
+    unsigned         benchmark_rounds          = 0;
+    const char *     classifier_type           = "basic";
+    unsigned         classifier_classes        = default_classifier_classes;
+    const char *     normalization             = "bytewise";
+    bool             use_tracing               = false;
+    bool             collect_perf_counters     = false;
+    const char *     sampling_policy           = "time";
+    const char *     warmup                    = "none";
+    const char *     load_profile              = "constant";
+    bool             use_open_loop             = false;
+    const char *     window                    = "none";
+    const char *     window_key                = "author";
 };
 
 enum class Sentiment { Positive, Negative, Neutral };
@@ -94,9 +130,63 @@ struct SentimentResult {
 };
 
 struct Tuple {
-    string          tweet;
+    string_view     tweet;
+    string_view     author_id;
     SentimentResult result;
     unsigned long   timestamp;
+    TupleTrace      trace {};
+};
+
+/*
+ * Tuple carrying several tweets, with their results and timestamps in
+ * parallel arrays, so that the classifier can score them in one loop.  It is
+ * traced as a whole, from the time its first tweet was due.
+ */
+struct TweetBatch {
+    vector<string_view>     tweets;
+    vector<SentimentResult> results;
+    vector<unsigned long>   timestamps;
+    TupleTrace              trace {};
+};
+
+/*
+ * Sentiment of the tweets sharing a key within a window, emitted by the
+ * aggregator.  The timestamp and trace are those of the newest tweet, so
+ * that latency runs from the time the tweet completing the window was due.
+ */
+struct SentimentWindow {
+    string_view   key;
+    unsigned long count          = 0;
+    long          score_sum      = 0;
+    unsigned long positive_count = 0;
+    unsigned long negative_count = 0;
+    unsigned long timestamp      = 0;
+    TupleTrace    trace {};
+
+    double get_mean_score() const {
+        return count > 0 ? score_sum / static_cast<double>(count) : 0.0;
+    }
+
+    /*
+     * Positive tweets per negative one, or their count if none is negative.
+     */
+    double get_positive_ratio() const {
+        return negative_count > 0
+                   ? positive_count / static_cast<double>(negative_count)
+                   : positive_count;
+    }
+};
+
+enum class WindowMode { None, Count, Time };
+
+/*
+ * Sliding window of the aggregator, whose length and slide are counted in
+ * tweets or in milliseconds.
+ */
+struct WindowSettings {
+    WindowMode    mode   = WindowMode::None;
+    unsigned long length = 0;
+    unsigned long slide  = 0;
 };
 
 static const struct option long_opts[] = {{"help", 0, 0, 'h'},
@@ -109,6 +199,23 @@ static const struct option long_opts[] = {{"help", 0, 0, 'h'},
                                           {"outputdir", 1, 0, 'o'},
                                           {"execmode", 1, 0, 'e'},
                                           {"timepolicy", 1, 0, 't'},
+                                          {"liveinterval", 1, 0, 'i'},
+                                          {"operatorstats", 1, 0, 'O'},
+                                          {"openloop", 1, 0, 'l'},
+                                          {"profile", 1, 0, 'L'},
+                                          {"warmup", 1, 0, 'w'},
+                                          {"samplingpolicy", 1, 0, 'S'},
+                                          {"perfcounters", 1, 0, 'C'},
+                                          {"affinity", 1, 0, 'A'},
+                                          {"tracing", 1, 0, 'H'},
+                                          {"classifier", 1, 0, 'x'},
+                                          {"classes", 1, 0, 'X'},
+                                          {"benchmark", 1, 0, 'B'},
+                                          {"streaming", 1, 0, 'm'},
+                                          {"microbatch", 1, 0, 'K'},
+                                          {"window", 1, 0, 'W'},
+                                          {"windowkey", 1, 0, 'k'},
+                                          {"normalization", 1, 0, 'N'},
                                           {0, 0, 0, 0}};
 
 /*
@@ -173,20 +280,693 @@ static inline vector<string_view> split_in_words_in_place(string &text) {
 }
 
 /*
- * Return a vector of tweets from a file named filename.
+ * Return whether c is an ASCII letter or digit, as isalnum() does in the C
+ * locale.
+ */
+static inline bool is_ascii_alnum(char c) {
+    const auto lowered = static_cast<unsigned char>(c | 0x20);
+    return static_cast<unsigned char>(c - '0') < 10
+           || static_cast<unsigned char>(lowered - 'a') < 26;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+static constexpr unsigned ascii_chunk_size = 32;
+#else
+static constexpr unsigned ascii_chunk_size = 16;
+#endif
+
+/*
+ * Normalize the ascii_chunk_size bytes at input into output, turning bytes
+ * other than ASCII letters and digits into spaces and letters into lowercase,
+ * and return the mask of the alphanumeric ones.
+ */
+static inline uint32_t normalize_ascii_chunk(const char *input,
+                                             char *      output) {
+#if defined(__AVX2__)
+    const __m256i letter_bias   = _mm256_set1_epi8(0x80 - 'a');
+    const __m256i letter_bound  = _mm256_set1_epi8(-128 + 26);
+    const __m256i digit_bias    = _mm256_set1_epi8(0x80 - '0');
+    const __m256i digit_bound   = _mm256_set1_epi8(-128 + 10);
+    const __m256i lowercase_bit = _mm256_set1_epi8(0x20);
+    const __m256i spaces        = _mm256_set1_epi8(' ');
+
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+    const __m256i lowered   = _mm256_or_si256(chunk, lowercase_bit);
+    const __m256i is_letter = _mm256_cmpgt_epi8(
+        letter_bound, _mm256_add_epi8(lowered, letter_bias));
+    const __m256i is_digit = _mm256_cmpgt_epi8(
+        digit_bound, _mm256_add_epi8(chunk, digit_bias));
+    const __m256i is_alnum = _mm256_or_si256(is_letter, is_digit);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output),
+                        _mm256_blendv_epi8(spaces, lowered, is_alnum));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(is_alnum));
+#else
+    const __m128i letter_bias   = _mm_set1_epi8(0x80 - 'a');
+    const __m128i letter_bound  = _mm_set1_epi8(-128 + 26);
+    const __m128i digit_bias    = _mm_set1_epi8(0x80 - '0');
+    const __m128i digit_bound   = _mm_set1_epi8(-128 + 10);
+    const __m128i lowercase_bit = _mm_set1_epi8(0x20);
+    const __m128i spaces        = _mm_set1_epi8(' ');
+
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    const __m128i lowered   = _mm_or_si128(chunk, lowercase_bit);
+    const __m128i is_letter = _mm_cmplt_epi8(
+        _mm_add_epi8(lowered, letter_bias), letter_bound);
+    const __m128i is_digit =
+        _mm_cmplt_epi8(_mm_add_epi8(chunk, digit_bias), digit_bound);
+    const __m128i is_alnum = _mm_or_si128(is_letter, is_digit);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output),
+                     _mm_or_si128(_mm_and_si128(is_alnum, lowered),
+                                  _mm_andnot_si128(is_alnum, spaces)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(is_alnum));
+#endif
+}
+
+/*
+ * Return the mask of the bytes of the ascii_chunk_size bytes at input that
+ * are not ASCII or are apostrophes, which normalize_ascii_chunk() cannot
+ * handle as UTF-8 word boundaries require.
+ */
+static inline uint32_t get_non_ascii_word_byte_mask(const char *input) {
+#if defined(__AVX2__)
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+    const __m256i is_apostrophe =
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\''));
+    return static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_or_si256(chunk, is_apostrophe)));
+#else
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    const __m128i is_apostrophe = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\''));
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_or_si128(chunk, is_apostrophe)));
+#endif
+}
+
+/*
+ * Hand on_word the words ending within the ascii_chunk_size bytes of data
+ * starting at chunk_start, given the mask of their alphanumeric bytes, and
+ * keep track of the word still open at the end of the chunk, if any.
+ */
+template<typename WordHandler>
+static inline void handle_chunk_words(const char *data, size_t chunk_start,
+                                      uint32_t mask, bool &is_in_word,
+                                      size_t &     word_start,
+                                      WordHandler &on_word) {
+    unsigned position = 0;
+    for (;;) {
+        const uint64_t pending = (is_in_word ? ~mask : mask)
+                                 & ((uint64_t {1} << ascii_chunk_size) - 1)
+                                 & (~uint64_t {0} << position);
+        if (pending == 0) {
+            break;
+        }
+        position = __builtin_ctzll(pending);
+        if (is_in_word) {
+            on_word(string_view {data + word_start,
+                                 chunk_start + position - word_start});
+        } else {
+            word_start = chunk_start + position;
+        }
+        is_in_word = !is_in_word;
+    }
+}
+#endif
+
+/*
+ * Call on_word with each "word" in text, as split_in_words_in_place() would
+ * find them, in a single pass.  The text is normalized into the normalized
+ * buffer just the same, a chunk of 32 (with AVX2) or 16 (with SSE2) bytes at
+ * a time: non-alphanumeric bytes turn into spaces, letters into lowercase,
+ * and the words ending within a chunk are handed to on_word, as views into
+ * the buffer, before moving on to the next one.  The buffer only grows, so
+ * reusing it avoids allocating once it fits the longest text.
+ */
+template<typename WordHandler>
+static inline void for_each_word(string_view text, string &normalized,
+                                 WordHandler on_word) {
+    if (normalized.size() < text.size()) {
+        normalized.resize(text.size());
+    }
+    const char *const input      = text.data();
+    char *const       data       = normalized.data();
+    const size_t      size       = text.size();
+    size_t            word_start = 0;
+    bool              is_in_word = false;
+    size_t            i          = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + ascii_chunk_size <= size; i += ascii_chunk_size) {
+        handle_chunk_words(data, i,
+                           normalize_ascii_chunk(input + i, data + i),
+                           is_in_word, word_start, on_word);
+    }
+#endif
+
+    for (; i < size; ++i) {
+        const bool is_alnum = is_ascii_alnum(input[i]);
+        data[i]             = is_alnum ? input[i] | 0x20 : ' ';
+        if (is_alnum && !is_in_word) {
+            word_start = i;
+        } else if (!is_alnum && is_in_word) {
+            on_word(string_view {data + word_start, i - word_start});
+        }
+        is_in_word = is_alnum;
+    }
+    if (is_in_word) {
+        on_word(string_view {data + word_start, size - word_start});
+    }
+}
+
+/*
+ * Return the name of the instruction set for_each_word() uses.
+ */
+static inline const char *get_tokenizer_kernel_name() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+/*
+ * How the UTF-8 tokenizer treats a code point: as part of a word (letters and
+ * digits), attached to the preceding one (combining marks and joiners), as a
+ * word of its own (Han ideographs and hiragana), as a separator, or as an
+ * apostrophe, which only joins two letters.
+ */
+enum class WordClass : uint8_t {
+    Separator,
+    Letter,
+    Digit,
+    Mark,
+    Ideograph,
+    Apostrophe
+};
+
+/*
+ * Code points from first to last sharing a word class.  Every stride-th of
+ * them, starting from first, is case folded by adding offset to it.
+ */
+struct CodePointRange {
+    char32_t  first;
+    char32_t  last;
+    WordClass word_class;
+    int32_t   offset = 0;
+    uint8_t   stride = 1;
+};
+
+/*
+ * Word classes and simple case folding of the letters of the scripts most
+ * often found in tweets, after the Unicode word break properties (UAX #29)
+ * and CaseFolding.txt, sorted by code point.  Folds that would make a
+ * character's encoding longer are left out, so that the normalized text
+ * never outgrows the original one.  Code points not listed are separators,
+ * emoji and other symbols included.
+ */
+static constexpr CodePointRange word_ranges[] = {
+    {0x27, 0x27, WordClass::Apostrophe},
+    {0x30, 0x39, WordClass::Digit},
+    {0x41, 0x5a, WordClass::Letter, 0x20},
+    {0x61, 0x7a, WordClass::Letter},
+    {0xaa, 0xaa, WordClass::Letter},
+    {0xad, 0xad, WordClass::Mark},
+    {0xb5, 0xb5, WordClass::Letter, 0x3bc - 0xb5},
+    {0xba, 0xba, WordClass::Letter},
+    {0xc0, 0xd6, WordClass::Letter, 0x20},
+    {0xd8, 0xde, WordClass::Letter, 0x20},
+    {0xdf, 0xf6, WordClass::Letter},
+    {0xf8, 0xff, WordClass::Letter},
+    {0x100, 0x12f, WordClass::Letter, 1, 2},
+    {0x130, 0x131, WordClass::Letter},
+    {0x132, 0x137, WordClass::Letter, 1, 2},
+    {0x138, 0x138, WordClass::Letter},
+    {0x139, 0x148, WordClass::Letter, 1, 2},
+    {0x149, 0x149, WordClass::Letter},
+    {0x14a, 0x177, WordClass::Letter, 1, 2},
+    {0x178, 0x178, WordClass::Letter, 0xff - 0x178},
+    {0x179, 0x17e, WordClass::Letter, 1, 2},
+    {0x17f, 0x17f, WordClass::Letter, 's' - 0x17f},
+    {0x180, 0x1cc, WordClass::Letter},
+    {0x1cd, 0x1dc, WordClass::Letter, 1, 2},
+    {0x1dd, 0x1dd, WordClass::Letter},
+    {0x1de, 0x1ef, WordClass::Letter, 1, 2},
+    {0x1f0, 0x1f7, WordClass::Letter},
+    {0x1f8, 0x21f, WordClass::Letter, 1, 2},
+    {0x220, 0x221, WordClass::Letter},
+    {0x222, 0x233, WordClass::Letter, 1, 2},
+    {0x234, 0x245, WordClass::Letter},
+    {0x246, 0x24f, WordClass::Letter, 1, 2},
+    {0x250, 0x2c1, WordClass::Letter},
+    {0x2c6, 0x2d1, WordClass::Letter},
+    {0x2e0, 0x2e4, WordClass::Letter},
+    {0x2ec, 0x2ec, WordClass::Letter},
+    {0x2ee, 0x2ee, WordClass::Letter},
+    {0x300, 0x36f, WordClass::Mark},
+    {0x370, 0x373, WordClass::Letter, 1, 2},
+    {0x374, 0x374, WordClass::Letter},
+    {0x376, 0x377, WordClass::Letter, 1, 2},
+    {0x37a, 0x37d, WordClass::Letter},
+    {0x37f, 0x37f, WordClass::Letter, 0x3f3 - 0x37f},
+    {0x386, 0x386, WordClass::Letter, 0x3ac - 0x386},
+    {0x388, 0x38a, WordClass::Letter, 0x3ad - 0x388},
+    {0x38c, 0x38c, WordClass::Letter, 0x3cc - 0x38c},
+    {0x38e, 0x38f, WordClass::Letter, 0x3cd - 0x38e},
+    {0x390, 0x390, WordClass::Letter},
+    {0x391, 0x3a1, WordClass::Letter, 0x20},
+    {0x3a3, 0x3ab, WordClass::Letter, 0x20},
+    {0x3ac, 0x3c1, WordClass::Letter},
+    {0x3c2, 0x3c2, WordClass::Letter, 1},
+    {0x3c3, 0x3ce, WordClass::Letter},
+    {0x3cf, 0x3cf, WordClass::Letter, 0x3d7 - 0x3cf},
+    {0x3d0, 0x3d7, WordClass::Letter},
+    {0x3d8, 0x3ef, WordClass::Letter, 1, 2},
+    {0x3f0, 0x3f5, WordClass::Letter},
+    {0x3f7, 0x3f8, WordClass::Letter, 1, 2},
+    {0x3f9, 0x3f9, WordClass::Letter, 0x3f2 - 0x3f9},
+    {0x3fa, 0x3fb, WordClass::Letter, 1, 2},
+    {0x3fc, 0x3fc, WordClass::Letter},
+    {0x3fd, 0x3ff, WordClass::Letter, 0x37b - 0x3fd},
+    {0x400, 0x40f, WordClass::Letter, 0x50},
+    {0x410, 0x42f, WordClass::Letter, 0x20},
+    {0x430, 0x45f, WordClass::Letter},
+    {0x460, 0x481, WordClass::Letter, 1, 2},
+    {0x483, 0x489, WordClass::Mark},
+    {0x48a, 0x4bf, WordClass::Letter, 1, 2},
+    {0x4c0, 0x4c0, WordClass::Letter, 0x4cf - 0x4c0},
+    {0x4c1, 0x4ce, WordClass::Letter, 1, 2},
+    {0x4cf, 0x4cf, WordClass::Letter},
+    {0x4d0, 0x52f, WordClass::Letter, 1, 2},
+    {0x531, 0x556, WordClass::Letter, 0x30},
+    {0x559, 0x559, WordClass::Letter},
+    {0x560, 0x588, WordClass::Letter},
+    {0x591, 0x5bd, WordClass::Mark},
+    {0x5bf, 0x5bf, WordClass::Mark},
+    {0x5c1, 0x5c2, WordClass::Mark},
+    {0x5c4, 0x5c5, WordClass::Mark},
+    {0x5c7, 0x5c7, WordClass::Mark},
+    {0x5d0, 0x5ea, WordClass::Letter},
+    {0x5ef, 0x5f3, WordClass::Letter},
+    {0x610, 0x61a, WordClass::Mark},
+    {0x620, 0x64a, WordClass::Letter},
+    {0x64b, 0x65f, WordClass::Mark},
+    {0x660, 0x669, WordClass::Digit},
+    {0x66e, 0x66f, WordClass::Letter},
+    {0x670, 0x670, WordClass::Mark},
+    {0x671, 0x6d3, WordClass::Letter},
+    {0x6d5, 0x6d5, WordClass::Letter},
+    {0x6d6, 0x6dc, WordClass::Mark},
+    {0x6df, 0x6e4, WordClass::Mark},
+    {0x6e5, 0x6e6, WordClass::Letter},
+    {0x6e7, 0x6e8, WordClass::Mark},
+    {0x6ea, 0x6ed, WordClass::Mark},
+    {0x6ee, 0x6ef, WordClass::Letter},
+    {0x6f0, 0x6f9, WordClass::Digit},
+    {0x6fa, 0x6fc, WordClass::Letter},
+    {0x6ff, 0x6ff, WordClass::Letter},
+    {0x710, 0x74f, WordClass::Letter},
+    {0x780, 0x7b1, WordClass::Letter},
+    {0x7c0, 0x7c9, WordClass::Digit},
+    {0x7ca, 0x7f5, WordClass::Letter},
+    {0x900, 0x963, WordClass::Letter},
+    {0x966, 0xe3a, WordClass::Letter},
+    {0xe40, 0xe4e, WordClass::Letter},
+    {0xe50, 0xe59, WordClass::Digit},
+    {0xe81, 0xedf, WordClass::Letter},
+    {0xf00, 0x109f, WordClass::Letter},
+    {0x10a0, 0x10c5, WordClass::Letter, 0x2d00 - 0x10a0},
+    {0x10c7, 0x10ff, WordClass::Letter},
+    {0x1100, 0x167f, WordClass::Letter},
+    {0x1681, 0x1cff, WordClass::Letter},
+    {0x1d00, 0x1dbf, WordClass::Letter},
+    {0x1dc0, 0x1dff, WordClass::Mark},
+    {0x1e00, 0x1e95, WordClass::Letter, 1, 2},
+    {0x1e96, 0x1e9d, WordClass::Letter},
+    {0x1e9e, 0x1e9e, WordClass::Letter, 0xdf - 0x1e9e},
+    {0x1e9f, 0x1e9f, WordClass::Letter},
+    {0x1ea0, 0x1eff, WordClass::Letter, 1, 2},
+    {0x1f00, 0x1f07, WordClass::Letter},
+    {0x1f08, 0x1f0f, WordClass::Letter, -8},
+    {0x1f10, 0x1f15, WordClass::Letter},
+    {0x1f18, 0x1f1d, WordClass::Letter, -8},
+    {0x1f20, 0x1f27, WordClass::Letter},
+    {0x1f28, 0x1f2f, WordClass::Letter, -8},
+    {0x1f30, 0x1f37, WordClass::Letter},
+    {0x1f38, 0x1f3f, WordClass::Letter, -8},
+    {0x1f40, 0x1f45, WordClass::Letter},
+    {0x1f48, 0x1f4d, WordClass::Letter, -8},
+    {0x1f50, 0x1f57, WordClass::Letter},
+    {0x1f59, 0x1f5f, WordClass::Letter, -8, 2},
+    {0x1f60, 0x1f67, WordClass::Letter},
+    {0x1f68, 0x1f6f, WordClass::Letter, -8},
+    {0x1f70, 0x1fbc, WordClass::Letter},
+    {0x1fc2, 0x1fcc, WordClass::Letter},
+    {0x1fd0, 0x1fdb, WordClass::Letter},
+    {0x1fe0, 0x1fec, WordClass::Letter},
+    {0x1ff2, 0x1ffc, WordClass::Letter},
+    {0x200c, 0x200d, WordClass::Mark},
+    {0x2019, 0x2019, WordClass::Apostrophe},
+    {0x2071, 0x2071, WordClass::Letter},
+    {0x207f, 0x207f, WordClass::Letter},
+    {0x2090, 0x209c, WordClass::Letter},
+    {0x20d0, 0x20ff, WordClass::Mark},
+    {0x2126, 0x2126, WordClass::Letter, 0x3c9 - 0x2126},
+    {0x212a, 0x212a, WordClass::Letter, 'k' - 0x212a},
+    {0x212b, 0x212b, WordClass::Letter, 0xe5 - 0x212b},
+    {0x2c00, 0x2c2f, WordClass::Letter, 0x30},
+    {0x2c30, 0x2cff, WordClass::Letter},
+    {0x2d00, 0x2ddf, WordClass::Letter},
+    {0x2de0, 0x2dff, WordClass::Mark},
+    {0x3005, 0x3007, WordClass::Ideograph},
+    {0x302a, 0x302f, WordClass::Mark},
+    {0x3041, 0x3096, WordClass::Ideograph},
+    {0x3099, 0x309a, WordClass::Mark},
+    {0x309d, 0x309f, WordClass::Ideograph},
+    {0x30a1, 0x30fa, WordClass::Letter},
+    {0x30fc, 0x30ff, WordClass::Letter},
+    {0x3105, 0x312f, WordClass::Letter},
+    {0x3131, 0x318e, WordClass::Letter},
+    {0x31f0, 0x31ff, WordClass::Letter},
+    {0x3400, 0x4dbf, WordClass::Ideograph},
+    {0x4e00, 0x9fff, WordClass::Ideograph},
+    {0xa000, 0xa48c, WordClass::Letter},
+    {0xa4d0, 0xa4fd, WordClass::Letter},
+    {0xa500, 0xa60c, WordClass::Letter},
+    {0xa640, 0xa66d, WordClass::Letter, 1, 2},
+    {0xa66e, 0xa66e, WordClass::Letter},
+    {0xa66f, 0xa67d, WordClass::Mark},
+    {0xa67f, 0xa67f, WordClass::Letter},
+    {0xa680, 0xa69b, WordClass::Letter, 1, 2},
+    {0xa69c, 0xa6ef, WordClass::Letter},
+    {0xa722, 0xa72f, WordClass::Letter, 1, 2},
+    {0xa730, 0xa731, WordClass::Letter},
+    {0xa732, 0xa76f, WordClass::Letter, 1, 2},
+    {0xa770, 0xabff, WordClass::Letter},
+    {0xac00, 0xd7a3, WordClass::Letter},
+    {0xd7b0, 0xd7fb, WordClass::Letter},
+    {0xf900, 0xfaff, WordClass::Ideograph},
+    {0xfb00, 0xfdff, WordClass::Letter},
+    {0xfe00, 0xfe0f, WordClass::Mark},
+    {0xfe20, 0xfe2f, WordClass::Mark},
+    {0xfe70, 0xfefc, WordClass::Letter},
+    {0xfeff, 0xfeff, WordClass::Mark},
+    {0xff10, 0xff19, WordClass::Digit},
+    {0xff21, 0xff3a, WordClass::Letter, 0x20},
+    {0xff41, 0xff5a, WordClass::Letter},
+    {0xff66, 0xffdc, WordClass::Letter},
+    {0x10000, 0x103ff, WordClass::Letter},
+    {0x10400, 0x10427, WordClass::Letter, 0x28},
+    {0x10428, 0x1bfff, WordClass::Letter},
+    {0x1d400, 0x1d7ff, WordClass::Letter},
+    {0x1e000, 0x1efff, WordClass::Letter},
+    {0x20000, 0x3ffff, WordClass::Ideograph},
+    {0xe0100, 0xe01ef, WordClass::Mark}};
+
+/*
+ * Return the length of the UTF-8 encoding of code_point.
+ */
+static constexpr unsigned get_utf8_length(char32_t code_point) {
+    return code_point < 0x80 ? 1 : code_point < 0x800 ? 2
+                               : code_point < 0x10000 ? 3
+                                                      : 4;
+}
+
+/*
+ * Return whether word_ranges is sorted, without overlaps, and only holds
+ * folds that keep code points in range and encodings no longer.
+ */
+static constexpr bool are_word_ranges_valid() {
+    char32_t next = 0;
+    for (const auto &range : word_ranges) {
+        const int64_t folded_first = int64_t {range.first} + range.offset;
+        const int64_t folded_last  = int64_t {range.last} + range.offset;
+        if (range.first < next || range.last < range.first
+            || get_utf8_length(range.first) != get_utf8_length(range.last)
+            || range.stride == 0 || folded_first < 0 || folded_last > 0x10ffff
+            || get_utf8_length(folded_first) > get_utf8_length(range.first)
+            || get_utf8_length(folded_last) > get_utf8_length(range.last)) {
+            return false;
+        }
+        next = range.last + 1;
+    }
+    return true;
+}
+
+static_assert(are_word_ranges_valid(),
+              "word_ranges must be sorted, disjoint and folds must not "
+              "lengthen encodings");
+
+/*
+ * Word class and case folding of a single code point.
+ */
+struct CodePointInfo {
+    char32_t  folded     = 0;
+    WordClass word_class = WordClass::Separator;
+};
+
+static constexpr CodePointInfo get_code_point_info(const CodePointRange &range,
+                                                   char32_t code_point) {
+    const bool is_folded = (code_point - range.first) % range.stride == 0;
+    return {is_folded ? code_point + range.offset : code_point,
+            range.word_class};
+}
+
+/*
+ * Number of code points whose information is looked up directly in a table,
+ * those encoded in up to two bytes, rather than searched in word_ranges.
+ */
+static constexpr char32_t direct_code_points = 0x800;
+
+static constexpr array<CodePointInfo, direct_code_points>
+get_direct_code_point_table() {
+    array<CodePointInfo, direct_code_points> table {};
+    for (char32_t code_point = 0; code_point < direct_code_points;
+         ++code_point) {
+        table[code_point].folded = code_point;
+    }
+    for (const auto &range : word_ranges) {
+        for (char32_t code_point = range.first;
+             code_point <= range.last && code_point < direct_code_points;
+             ++code_point) {
+            table[code_point] = get_code_point_info(range, code_point);
+        }
+    }
+    return table;
+}
+
+static constexpr auto direct_code_point_table = get_direct_code_point_table();
+
+/*
+ * Return the word class and case folding of code_point.
+ */
+static inline CodePointInfo get_code_point_info(char32_t code_point) {
+    if (code_point < direct_code_points) {
+        return direct_code_point_table[code_point];
+    }
+    const auto range = upper_bound(
+        begin(word_ranges), end(word_ranges), code_point,
+        [](char32_t c, const CodePointRange &r) { return c < r.first; });
+    if (range == begin(word_ranges) || code_point > prev(range)->last) {
+        return {code_point, WordClass::Separator};
+    }
+    return get_code_point_info(*prev(range), code_point);
+}
+
+/*
+ * Decode the UTF-8 sequence starting at position, before end, into
+ * code_point and return its length, or return 0 if it is malformed,
+ * overlong or encodes a surrogate.
+ */
+static inline size_t decode_utf8(const char *position, const char *end,
+                                 char32_t &code_point) {
+    const auto lead = static_cast<unsigned char>(*position);
+    if (lead < 0x80) {
+        code_point = lead;
+        return 1;
+    }
+    const size_t length = lead < 0xc2   ? 0
+                          : lead < 0xe0 ? 2
+                          : lead < 0xf0 ? 3
+                          : lead < 0xf5 ? 4
+                                        : 0;
+    if (length == 0 || end - position < static_cast<ptrdiff_t>(length)) {
+        return 0;
+    }
+    code_point = lead & (0x7f >> length);
+    for (size_t i = 1; i < length; ++i) {
+        const auto byte = static_cast<unsigned char>(position[i]);
+        if ((byte & 0xc0) != 0x80) {
+            return 0;
+        }
+        code_point = code_point << 6 | (byte & 0x3f);
+    }
+    if (get_utf8_length(code_point) != length || code_point > 0x10ffff
+        || (code_point >= 0xd800 && code_point < 0xe000)) {
+        return 0;
+    }
+    return length;
+}
+
+/*
+ * Call on_word with each word in text, found on Unicode word boundaries
+ * rather than on bytes: letters, digits and the combining marks following
+ * them make up words, apostrophes join two letters, as in "don't", and Han
+ * ideographs and hiragana are words of their own.  Words are case folded
+ * into the normalized buffer, with the typographic apostrophe turned into
+ * the ASCII one, and handed to on_word as views into it.  Chunks of plain
+ * ASCII text are normalized as for_each_word() does, while the others are
+ * decoded a code point at a time and looked up in word_ranges, with no
+ * locale involved.  Text is not brought to any Unicode normalization form,
+ * so decomposed accents do not match precomposed ones.
+ */
+template<typename WordHandler>
+static inline void for_each_utf8_word(string_view text, string &normalized,
+                                      WordHandler on_word) {
+    if (normalized.size() < text.size()) {
+        normalized.resize(text.size());
+    }
+    const char *const input      = text.data();
+    const char *const input_end  = input + text.size();
+    char *const       data       = normalized.data();
+    const size_t      size       = text.size();
+    size_t            word_start = 0;
+    bool              is_in_word = false;
+    WordClass         last_class = WordClass::Separator;
+    size_t            i          = 0;
+    size_t            output     = 0;
+
+    const auto end_word = [&] {
+        if (is_in_word) {
+            on_word(string_view {data + word_start, output - word_start});
+            is_in_word = false;
+        }
+    };
+    const auto start_word = [&](WordClass word_class) {
+        end_word();
+        word_start = output;
+        is_in_word = true;
+        last_class = word_class;
+    };
+    const auto is_letter_at = [&](size_t position) {
+        char32_t code_point;
+        return position < size
+               && decode_utf8(input + position, input_end, code_point) > 0
+               && get_code_point_info(code_point).word_class
+                      == WordClass::Letter;
+    };
+    const auto handle_code_point = [&] {
+        char32_t     code_point;
+        const size_t length = decode_utf8(input + i, input_end, code_point);
+        if (length == 0) {
+            end_word();
+            ++i;
+            return;
+        }
+        const auto info = get_code_point_info(code_point);
+        switch (info.word_class) {
+        case WordClass::Letter:
+        case WordClass::Digit:
+            if (!is_in_word || last_class == WordClass::Ideograph) {
+                start_word(info.word_class);
+            }
+            last_class = info.word_class;
+            output     = encode_utf8(info.folded, data + output) - data;
+            break;
+        case WordClass::Ideograph:
+            start_word(info.word_class);
+            output = encode_utf8(info.folded, data + output) - data;
+            break;
+        case WordClass::Mark:
+            if (is_in_word) {
+                output = encode_utf8(info.folded, data + output) - data;
+            }
+            break;
+        case WordClass::Apostrophe:
+            if (is_in_word && last_class == WordClass::Letter
+                && is_letter_at(i + length)) {
+                data[output++] = '\'';
+            } else {
+                end_word();
+            }
+            break;
+        default:
+            end_word();
+            break;
+        }
+        i += length;
+    };
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (i + ascii_chunk_size <= size) {
+        if (get_non_ascii_word_byte_mask(input + i) == 0) {
+            if (is_in_word && last_class == WordClass::Ideograph) {
+                end_word();
+            }
+            handle_chunk_words(
+                data, output,
+                normalize_ascii_chunk(input + i, data + output), is_in_word,
+                word_start, on_word);
+            i += ascii_chunk_size;
+            output += ascii_chunk_size;
+            if (is_in_word) {
+                last_class = data[output - 1] <= '9' ? WordClass::Digit
+                                                     : WordClass::Letter;
+            }
+        } else {
+            for (const size_t chunk_end = i + ascii_chunk_size;
+                 i < chunk_end;) {
+                handle_code_point();
+            }
+        }
+    }
+#endif
+
+    while (i < size) {
+        handle_code_point();
+    }
+    end_word();
+}
+
+enum class Normalization { Bytewise, Utf8 };
+
+/*
+ * Return the Normalization named by s, as given on the command line.
  */
-static inline vector<string> get_tweets_from_file(const string &filename) {
-    ifstream       twitterstream {filename};
-    vector<string> tweets;
+static inline Normalization get_normalization_from_string(const string &s) {
+    if (s == "bytewise") {
+        return Normalization::Bytewise;
+    } else if (s == "utf8") {
+        return Normalization::Utf8;
+    } else {
+        cerr << "get_normalization_from_string:  error, unknown "
+                "normalization: "
+             << s << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
 
-    while (twitterstream.good()) {
-        nlohmann::json new_tweet;
-        twitterstream >> new_tweet;
-        tweets.push_back(move(new_tweet["data"]["text"]));
-        twitterstream >> ws;
+/*
+ * Call on_word with each word in text, as found by for_each_word() or by
+ * for_each_utf8_word() depending on normalization.
+ */
+template<typename WordHandler>
+static inline void for_each_normalized_word(Normalization normalization,
+                                            string_view   text,
+                                            string &      normalized,
+                                            WordHandler   on_word) {
+    if (normalization == Normalization::Utf8) {
+        for_each_utf8_word(text, normalized, on_word);
+    } else {
+        for_each_word(text, normalized, on_word);
     }
-    tweets.shrink_to_fit();
-    return tweets;
 }
 
 /*
@@ -210,6 +990,82 @@ static inline Map get_sentiment_map(const string &path) {
     return sentiment_map;
 }
 
+/*
+ * Parse the aggregator window given as none, count,<length>,<slide> (in
+ * tweets) or time,<length>,<slide> (in milliseconds) on the command line.
+ */
+static inline WindowSettings get_window_from_string(const string &s) {
+    const auto fields = string_split(s, ',');
+    const auto arguments =
+        get_spec_arguments(fields, "get_window_from_string");
+    const string   mode = fields.empty() ? "" : string {fields[0]};
+    WindowSettings settings;
+
+    if (mode == "none" && arguments.empty()) {
+        settings.mode = WindowMode::None;
+    } else if ((mode == "count" || mode == "time") && arguments.size() == 2
+               && arguments[0] >= 1.0 && arguments[1] >= 1.0
+               && arguments[1] <= arguments[0]) {
+        settings.mode =
+            mode == "count" ? WindowMode::Count : WindowMode::Time;
+        settings.length = arguments[0];
+        settings.slide  = arguments[1];
+    } else {
+        cerr << "get_window_from_string:  error, invalid window (length and "
+                "slide must be positive, the slide no longer than the "
+                "length)\n";
+        exit(EXIT_FAILURE);
+    }
+    return settings;
+}
+
+/*
+ * Return the first hashtag in text, without its '#', or an empty view if
+ * there is none.  A hashtag runs up to the first character that is neither
+ * alphanumeric nor an underscore, or a byte of a multibyte UTF-8 sequence.
+ */
+static inline string_view get_first_hashtag(string_view text) {
+    const auto is_hashtag_char = [](char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_'
+               || static_cast<unsigned char>(c) >= 0x80;
+    };
+
+    for (size_t start = text.find('#'); start != string_view::npos;
+         start        = text.find('#', start + 1)) {
+        size_t end = start + 1;
+        while (end < text.size() && is_hashtag_char(text[end])) {
+            ++end;
+        }
+        if (end > start + 1) {
+            return text.substr(start + 1, end - start - 1);
+        }
+    }
+    return {};
+}
+
+/*
+ * Copy per-operator values given on the command line to the node_count
+ * entries of node_values.  The aggregator's value may be left out, in which
+ * case the values belong to the other operators and the aggregator keeps
+ * its default.  Return false if the number of values fits neither case.
+ */
+template<typename Value, typename NodeValue>
+static inline bool assign_node_values(const vector<Value> &values,
+                                      NodeValue *node_values,
+                                      size_t     node_count) {
+    if (values.size() == node_count) {
+        copy(values.begin(), values.end(), node_values);
+        return true;
+    }
+    if (values.size() + 1 == node_count) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            node_values[i < aggregator_id ? i : i + 1] = values[i];
+        }
+        return true;
+    }
+    return false;
+}
+
 /*
  * Store command line parameters into the Parameters structure passed as
  * argument.
@@ -218,8 +1074,10 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
     int option;
     int index;
 
-    while ((option = getopt_long(argc, argv, "r:s:p:b:c:d:o:e:t:h", long_opts,
-                                 &index))
+    while ((option = getopt_long(argc, argv,
+                                 "r:s:p:b:c:d:o:e:t:i:O:l:L:w:S:C:A:H:x:X:"
+                                 "B:m:K:W:k:N:h",
+                                 long_opts, &index))
            != -1) {
         switch (option) {
         case 'r':
@@ -230,28 +1088,35 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
             break;
         case 'b': {
             const auto batches = get_nums_split_by_commas(optarg);
-            if (batches.size() != num_nodes - 1) {
+            if (!assign_node_values(batches, parameters.batch_size,
+                                    num_nodes - 1)) {
                 cerr << "Error in parsing the input arguments.  Batch sizes "
-                        "string requires exactly "
-                     << (num_nodes - 1) << " elements\n";
+                        "string requires "
+                     << (num_nodes - 2) << " or " << (num_nodes - 1)
+                     << " elements\n";
                 exit(EXIT_FAILURE);
-            } else {
-                for (unsigned i = 0; i < num_nodes - 1; ++i) {
-                    parameters.batch_size[i] = batches[i];
-                }
             }
         } break;
         case 'p': {
             const auto degrees = get_nums_split_by_commas(optarg);
-            if (degrees.size() != num_nodes) {
+            if (!assign_node_values(degrees, parameters.parallelism,
+                                    num_nodes)) {
                 cerr << "Error in parsing the input arguments.  Parallelism "
-                        "degree string requires exactly "
-                     << num_nodes << " elements.\n";
+                        "degree string requires "
+                     << (num_nodes - 1) << " or " << num_nodes
+                     << " elements.\n";
+                exit(EXIT_FAILURE);
+            }
+        } break;
+        case 'A': {
+            const auto core_lists = get_affinity_from_string(optarg);
+            if (!assign_node_values(core_lists, parameters.affinity,
+                                    num_nodes)) {
+                cerr << "Error in parsing the input arguments.  Affinity "
+                        "string requires "
+                     << (num_nodes - 1) << " or " << num_nodes
+                     << " core lists.\n";
                 exit(EXIT_FAILURE);
-            } else {
-                for (unsigned i = 0; i < num_nodes; ++i) {
-                    parameters.parallelism[i] = degrees[i];
-                }
             }
         } break;
         case 'c':
@@ -269,11 +1134,76 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
         case 't':
             parameters.time_policy = get_time_policy_from_string(optarg);
             break;
+        case 'i':
+            parameters.live_interval = atoi(optarg);
+            break;
+        case 'O':
+            parameters.collect_operator_stats = get_bool_from_string(optarg);
+            break;
+        case 'l':
+            parameters.use_open_loop = get_bool_from_string(optarg);
+            break;
+        case 'L':
+            parameters.load_profile = optarg;
+            break;
+        case 'w':
+            parameters.warmup = optarg;
+            break;
+        case 'S':
+            parameters.sampling_policy = optarg;
+            break;
+        case 'C':
+            parameters.collect_perf_counters = get_bool_from_string(optarg);
+            break;
+        case 'H':
+            parameters.use_tracing = get_bool_from_string(optarg);
+            break;
+        case 'x':
+            parameters.classifier_type = optarg;
+            break;
+        case 'X':
+            parameters.classifier_classes = atoi(optarg);
+            break;
+        case 'B':
+            parameters.benchmark_rounds = atoi(optarg);
+            break;
+        case 'm':
+            parameters.use_streaming = get_bool_from_string(optarg);
+            break;
+        case 'K':
+            parameters.tweets_per_tuple = atoi(optarg);
+            break;
+        case 'W':
+            parameters.window = optarg;
+            break;
+        case 'k':
+            parameters.window_key = optarg;
+            break;
+        case 'N':
+            parameters.normalization = optarg;
+            break;
         case 'h':
             cout << "Parameters: --rate <value> --sampling "
                     "<value> --batch <size> --parallelism "
-                    "<nSource,nClassifier,nSink> [--duration <seconds>] "
-                    "[--chaining <value>]\n";
+                    "<nSource,nClassifier[,nAggregator],nSink> "
+                    "[--duration <seconds>] "
+                    "[--chaining <value>] [--liveinterval <msec>] "
+                    "[--operatorstats <value>] "
+                    "[--openloop <value>] "
+                    "[--profile <shape[,argument...]>] "
+                    "[--warmup <mode[,argument]>] "
+                    "[--samplingpolicy <policy[,argument]>] "
+                    "[--perfcounters <value>] "
+                    "[--affinity <cores,cores,...>] "
+                    "[--tracing <value>] "
+                    "[--classifier <type>] "
+                    "[--classes <count>] "
+                    "[--benchmark <rounds>] "
+                    "[--streaming <value>] "
+                    "[--microbatch <tweets>] "
+                    "[--window <mode[,length,slide]>] "
+                    "[--windowkey <key>] "
+                    "[--normalization <mode>]\n";
             exit(EXIT_SUCCESS);
             break;
         default:
@@ -301,6 +1231,61 @@ static inline void validate_args(const Parameters &parameters) {
             exit(EXIT_FAILURE);
         }
     }
+
+    if (parameters.use_open_loop && parameters.tuple_rate == 0) {
+        cerr << "Error: open-loop generation requires a positive tuple "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (string {parameters.load_profile} != "constant"
+        && parameters.tuple_rate == 0) {
+        cerr << "Error: load profiles other than constant need a positive "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+    if (parameters.tuple_rate > 0) {
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration);
+    }
+
+    get_warmup_from_string(parameters.warmup, parameters.duration);
+
+    get_sampling_policy_from_string(parameters.sampling_policy,
+                                    parameters.sampling_rate);
+
+    if (parameters.tweets_per_tuple == 0) {
+        cerr << "Error: the number of tweets per tuple must be positive\n";
+        exit(EXIT_FAILURE);
+    }
+
+    const auto window = get_window_from_string(parameters.window);
+    if (window.mode != WindowMode::None && parameters.tweets_per_tuple > 1) {
+        cerr << "Error: windowed aggregation needs one tweet per tuple\n";
+        exit(EXIT_FAILURE);
+    }
+
+    const string window_key = parameters.window_key;
+    if (window_key != "author" && window_key != "hashtag") {
+        cerr << "Error: unknown window key: " << window_key << '\n';
+        exit(EXIT_FAILURE);
+    }
+
+    if (parameters.classifier_classes < 2
+        || parameters.classifier_classes > max_classifier_classes) {
+        cerr << "Error: the number of classes must be between 2 and "
+             << max_classifier_classes << '\n';
+        exit(EXIT_FAILURE);
+    }
+
+    if (get_normalization_from_string(parameters.normalization)
+            != Normalization::Bytewise
+        && string {parameters.classifier_type} == "aho-corasick") {
+        cerr << "Error: the aho-corasick classifier only supports bytewise "
+                "normalization\n";
+        exit(EXIT_FAILURE);
+    }
 }
 
 /*
@@ -312,6 +1297,8 @@ static inline void print_initial_parameters(const Parameters &parameters) {
          << '\n'
          << "Classifier parallelism:\t"
          << parameters.parallelism[classifier_id] << '\n'
+         << "Aggregator parallelism:\t"
+         << parameters.parallelism[aggregator_id] << '\n'
          << "Sink parallelism:\t" << parameters.parallelism[sink_id] << '\n'
          << "Batching:\n";
 
@@ -349,6 +1336,55 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 
     cout << "Chaining:\t" << (parameters.use_chaining ? "enabled" : "disabled")
          << '\n';
+
+    cout << "Live metrics interval:\t";
+    if (parameters.live_interval > 0) {
+        cout << parameters.live_interval << " ms\n";
+    } else {
+        cout << "disabled\n";
+    }
+
+    cout << "Per-operator statistics:\t"
+         << (parameters.collect_operator_stats ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Open-loop generation:\t"
+         << (parameters.use_open_loop ? "enabled" : "disabled") << '\n';
+
+    cout << "Load profile:\t" << parameters.load_profile << '\n';
+
+    cout << "Warm-up:\t" << parameters.warmup << '\n';
+
+    cout << "Sampling policy:\t" << parameters.sampling_policy << '\n';
+
+    cout << "Performance counters:\t"
+         << (parameters.collect_perf_counters ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Affinity:\t";
+    for (unsigned i = 0; i < num_nodes; ++i) {
+        cout << (i > 0 ? "," : "")
+             << get_string_from_core_list(parameters.affinity[i]);
+    }
+    cout << '\n';
+
+    cout << "Per-hop tracing:\t"
+         << (parameters.use_tracing ? "enabled" : "disabled") << '\n';
+
+    cout << "Classifier type:\t" << parameters.classifier_type << '\n';
+
+    cout << "Classifier classes:\t" << parameters.classifier_classes << '\n';
+
+    cout << "Normalization:\t" << parameters.normalization << '\n';
+
+    cout << "Tweet loading:\t"
+         << (parameters.use_streaming ? "streaming" : "indexed") << '\n';
+
+    cout << "Tweets per tuple:\t" << parameters.tweets_per_tuple << '\n';
+
+    cout << "Aggregation window:\t" << parameters.window << '\n';
+
+    cout << "Window key:\t" << parameters.window_key << '\n';
 }
 
 /*
@@ -357,24 +1393,47 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 static atomic_ulong          global_sent_tuples {0};
 static atomic_ulong          global_received_tuples {0};
 static Metric<unsigned long> global_latency_metric {"sa-latency"};
+static Metric<unsigned long> global_schedule_lag_metric {"sa-schedule-lag"};
+static LiveMetricsReporter   global_live_metrics;
+static OperatorStatsRegistry global_operator_stats;
 #ifndef NDEBUG
 static mutex print_mutex;
 #endif
 
 /*
- * Source operator internal logic.
+ * Source operator internal logic.  Output is either a Tuple per tweet or a
+ * TweetBatch of tweets_per_tuple tweets, each stamped when it was due, so
+ * that the time a tweet waits for its batch to fill counts in its latency.
  */
+template<typename Output>
 class SourceFunctor {
-    static constexpr auto default_path = "tweetstream.jsonl";
-    vector<string>        tweets;
-    unsigned long         duration;
-    unsigned              tuple_rate_per_second;
+    static constexpr auto        default_path = "tweetstream.jsonl";
+    shared_ptr<const TweetCorpus> tweets;
+    unsigned long                duration;
+    unsigned                     tuple_rate_per_second;
+    LoadProfile                  load_profile;
+    bool                         open_loop;
+    unsigned                     tweets_per_tuple;
+
+    static void ship_batch(Source_Shipper<TweetBatch> &shipper,
+                           TweetBatch &batch, TraceSampler &trace_sampler) {
+        batch.trace = trace_sampler.start_trace(batch.timestamps.front());
+        shipper.push(move(batch));
+        batch = TweetBatch {};
+    }
 
 public:
-    SourceFunctor(unsigned d, unsigned rate, const char *path = default_path)
-        : tweets {get_tweets_from_file(path)},
-          duration {d * timeunit_scale_factor}, tuple_rate_per_second {rate} {
-        if (tweets.empty()) {
+    SourceFunctor(unsigned d, const LoadProfile &profile,
+                  bool open_loop = false, bool streaming = false,
+                  unsigned parallelism = 1, unsigned tweets_per_tuple = 1,
+                  const char *path = default_path)
+        : tweets {
+            make_shared<const TweetCorpus>(path, streaming, parallelism)},
+          duration {d * timeunit_scale_factor},
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile}, open_loop {open_loop},
+          tweets_per_tuple {tweets_per_tuple} {
+        if (tweets->empty()) {
             cerr << "Error: empty tweet stream.  Check whether dataset "
                     "file "
                     "exists and is readable\n";
@@ -382,32 +1441,70 @@ public:
         }
     }
 
-    void operator()(Source_Shipper<Tuple> &shipper) {
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
-        size_t              index       = 0;
+    void operator()(Source_Shipper<Output> &shipper,
+                    RuntimeContext &        context) {
+        global_thread_placement.pin_current_thread("source",
+                                                   context.getReplicaIndex());
+
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
+        TweetReplayer       replayer {*tweets, context.getReplicaIndex()};
+        TraceSampler        trace_sampler;
+        TweetBatch          batch;
+
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, open_loop);
+        }
 
-        while (current_time() < end_time) {
-            const auto &tweet = tweets[index];
+        while (!deadline.has_expired()) {
+            const auto tweet = replayer.next();
 #ifndef NDEBUG
             {
                 lock_guard lock {print_mutex};
-                clog << "[SOURCE] Sending the following tweet: " << tweet
-                     << '\n';
+                clog << "[SOURCE] Sending the following tweet: "
+                     << tweet.text << '\n';
             }
 #endif
-            const unsigned long timestamp = current_time();
-            shipper.push({tweet, SentimentResult {}, timestamp});
-            ++sent_tuples;
-            index = (index + 1) % tweets.size();
-
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            const unsigned long timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
+            if constexpr (is_same_v<Output, TweetBatch>) {
+                if (batch.tweets.empty()) {
+                    batch.tweets.reserve(tweets_per_tuple);
+                    batch.timestamps.reserve(tweets_per_tuple);
+                }
+                batch.tweets.push_back(tweet.text);
+                batch.timestamps.push_back(timestamp);
+                if (batch.tweets.size() == tweets_per_tuple) {
+                    ship_batch(shipper, batch, trace_sampler);
+                }
+            } else {
+                shipper.push({tweet.text, tweet.author_id,
+                              SentimentResult {}, timestamp,
+                              trace_sampler.start_trace(timestamp)});
+            }
+            if (global_measurement_window.contains(timestamp)) {
+                ++sent_tuples;
+            } else {
+                ++excluded_tuples;
+            }
+            live_counters.add_tuples();
+        }
+        if constexpr (is_same_v<Output, TweetBatch>) {
+            if (!batch.tweets.empty()) {
+                ship_batch(shipper, batch, trace_sampler);
             }
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
+        if (open_loop) {
+            global_schedule_lag_metric.merge(
+                rate_controller->get_lag_samples());
+        }
     }
 };
 
@@ -418,188 +1515,1244 @@ class BasicClassifier {
     static constexpr auto             default_path = "AFINN-111.txt";
     hash<string_view>                 gethash;
     unordered_map<unsigned long, int> sentiment_map;
+    string                            normalized_tweet;
+    Normalization                     normalization;
 
 public:
-    BasicClassifier(const char *path = default_path)
-        : sentiment_map {get_sentiment_map<decltype(sentiment_map)>(path)} {}
-
-    SentimentResult classify(string &tweet) const {
-        const auto words                   = split_in_words_in_place(tweet);
-        int        current_tweet_sentiment = 0;
-
-        for (const auto &word : words) {
-            const unsigned long word_hash = gethash(word);
-            const auto sentiment_entry    = sentiment_map.find(word_hash);
-            if (sentiment_entry != sentiment_map.end()) {
+    BasicClassifier(Normalization normalization = Normalization::Bytewise,
+                    const char *  path          = default_path)
+        : sentiment_map {get_sentiment_map<decltype(sentiment_map)>(path)},
+          normalization {normalization} {}
+
+    SentimentResult classify(string_view tweet) {
+        int current_tweet_sentiment = 0;
+
+        for_each_normalized_word(
+            normalization, tweet, normalized_tweet, [&](string_view word) {
+                const unsigned long word_hash = gethash(word);
+                const auto sentiment_entry    = sentiment_map.find(word_hash);
+                if (sentiment_entry != sentiment_map.end()) {
 #ifndef NDEBUG
-                {
-                    lock_guard lock {print_mutex};
-                    clog << "[BASIC CLASSIFIER] Current word: "
-                         << sentiment_entry->first
-                         << ", with score: " << sentiment_entry->second
-                         << '\n';
-                }
+                    {
+                        lock_guard lock {print_mutex};
+                        clog << "[BASIC CLASSIFIER] Current word: "
+                             << sentiment_entry->first
+                             << ", with score: " << sentiment_entry->second
+                             << '\n';
+                    }
+#endif
+                    current_tweet_sentiment += sentiment_entry->second;
+                }
+            });
+        return {score_to_sentiment(current_tweet_sentiment),
+                current_tweet_sentiment};
+    }
+};
+
+/*
+ * A minimal perfect hash table from words to sentiment scores, built at
+ * compile time with hash and displace: words are split into buckets, and each
+ * bucket, largest first, gets the first displacement that sends all of its
+ * words to free slots.  Slots hold whole words, so that a lookup compares the
+ * full key instead of trusting the hash.  A lookup reads the displacement of
+ * its bucket, from a table of two bytes per bucket that is usually cached,
+ * then a single 32-byte slot, which never straddles a cache line.
+ */
+template<size_t N>
+class StaticLexicon {
+public:
+    static constexpr size_t max_word_length = 30;
+
+private:
+    struct alignas(32) Slot {
+        char          word[max_word_length] {};
+        unsigned char length = 0;
+        signed char   score  = 0;
+    };
+
+    static constexpr size_t   num_buckets       = (N + 2) / 3;
+    static constexpr unsigned max_displacement  = 0xffff;
+    static constexpr uint64_t displacement_step = 0x9e3779b97f4a7c15;
+
+    array<Slot, N>                     slots {};
+    array<unsigned short, num_buckets> displacements {};
+    bool                               valid = false;
+
+    static constexpr uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccd;
+        x ^= x >> 33;
+        return x;
+    }
+
+    static constexpr uint64_t hash(string_view word) {
+        uint64_t h = 0xcbf29ce484222325;
+        for (const char c : word) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001b3;
+        }
+        return h;
+    }
+
+    static constexpr size_t get_bucket(uint64_t word_hash) {
+        return mix(word_hash) % num_buckets;
+    }
+
+    static constexpr size_t get_slot(uint64_t word_hash,
+                                     unsigned displacement) {
+        return mix(word_hash + (displacement + 1) * displacement_step) % N;
+    }
+
+public:
+    /*
+     * Leave the table invalid if a word is too long, a score does not fit or
+     * a bucket cannot be placed, as happens with duplicate words.
+     */
+    constexpr StaticLexicon(const pair<string_view, int> (&entries)[N]) {
+        array<uint64_t, N>             hashes {};
+        array<size_t, num_buckets + 1> bucket_start {};
+        array<size_t, num_buckets>     bucket_fill {};
+        array<size_t, N>               bucket_members {};
+        array<bool, N>                 is_taken {};
+        size_t                         max_bucket_size = 0;
+
+        for (size_t i = 0; i < N; ++i) {
+            const auto &[word, score] = entries[i];
+            if (word.size() > max_word_length || score < -128 || score > 127) {
+                return;
+            }
+            hashes[i] = hash(word);
+            ++bucket_start[get_bucket(hashes[i]) + 1];
+        }
+        for (size_t b = 0; b < num_buckets; ++b) {
+            max_bucket_size = max(max_bucket_size, bucket_start[b + 1]);
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        for (size_t i = 0; i < N; ++i) {
+            const auto b = get_bucket(hashes[i]);
+            bucket_members[bucket_start[b] + bucket_fill[b]++] = i;
+        }
+
+        for (size_t size = max_bucket_size; size > 0; --size) {
+            for (size_t b = 0; b < num_buckets; ++b) {
+                const size_t first = bucket_start[b];
+                const size_t last  = bucket_start[b + 1];
+                if (last - first != size) {
+                    continue;
+                }
+
+                unsigned displacement = 0;
+                for (bool fits = false; !fits; ++displacement) {
+                    if (displacement > max_displacement) {
+                        return;
+                    }
+                    fits = true;
+                    for (size_t j = first; j < last && fits; ++j) {
+                        const auto slot =
+                            get_slot(hashes[bucket_members[j]], displacement);
+                        fits = !is_taken[slot];
+                        for (size_t k = first; k < j && fits; ++k) {
+                            fits = get_slot(hashes[bucket_members[k]],
+                                            displacement)
+                                   != slot;
+                        }
+                    }
+                }
+                --displacement;
+
+                displacements[b] = displacement;
+                for (size_t j = first; j < last; ++j) {
+                    const auto i    = bucket_members[j];
+                    const auto slot = get_slot(hashes[i], displacement);
+                    const auto word = entries[i].first;
+                    for (size_t c = 0; c < word.size(); ++c) {
+                        slots[slot].word[c] = word[c];
+                    }
+                    slots[slot].length = word.size();
+                    slots[slot].score  = entries[i].second;
+                    is_taken[slot]     = true;
+                }
+            }
+        }
+        valid = true;
+    }
+
+    constexpr bool is_valid() const {
+        return valid;
+    }
+
+    constexpr optional<int> find(string_view word) const {
+        const uint64_t word_hash = hash(word);
+        const auto &   slot =
+            slots[get_slot(word_hash, displacements[get_bucket(word_hash)])];
+        if (string_view {slot.word, slot.length} == word) {
+            return slot.score;
+        }
+        return {};
+    }
+};
+
+static constexpr StaticLexicon afinn_lexicon {afinn_111_entries};
+static_assert(afinn_lexicon.is_valid(),
+              "cannot build a perfect hash table for the AFINN lexicon");
+
+/*
+ * This classifier associates a score to each word, like BasicClassifier, but
+ * looks words up in the AFINN lexicon compiled into the program.
+ */
+class PerfectHashClassifier {
+    string        normalized_tweet;
+    Normalization normalization;
+
+public:
+    PerfectHashClassifier(
+        Normalization normalization = Normalization::Bytewise)
+        : normalization {normalization} {}
+
+    SentimentResult classify(string_view tweet) {
+        int current_tweet_sentiment = 0;
+
+        for_each_normalized_word(
+            normalization, tweet, normalized_tweet, [&](string_view word) {
+                const auto score = afinn_lexicon.find(word);
+                if (score) {
+#ifndef NDEBUG
+                    {
+                        lock_guard lock {print_mutex};
+                        clog << "[PERFECT HASH CLASSIFIER] Current word: "
+                             << word << ", with score: " << *score << '\n';
+                    }
+#endif
+                    current_tweet_sentiment += *score;
+                }
+            });
+        return {score_to_sentiment(current_tweet_sentiment),
+                current_tweet_sentiment};
+    }
+};
+
+/*
+ * Return the table mapping bytes to the symbols AhoCorasickClassifier works
+ * on: 1 for anything but letters and digits, which all act as spaces, then
+ * one symbol per letter, regardless of case, and one per digit.
+ */
+static constexpr array<uint8_t, 256> get_aho_corasick_symbols() {
+    array<uint8_t, 256> symbols {};
+    for (unsigned c = 0; c < symbols.size(); ++c) {
+        symbols[c] = 1;
+    }
+    for (unsigned c = 'a'; c <= 'z'; ++c) {
+        symbols[c]             = 2 + c - 'a';
+        symbols[c - 'a' + 'A'] = 2 + c - 'a';
+    }
+    for (unsigned c = '0'; c <= '9'; ++c) {
+        symbols[c] = 28 + c - '0';
+    }
+    return symbols;
+}
+
+static constexpr auto aho_corasick_symbols = get_aho_corasick_symbols();
+
+/*
+ * This classifier matches every lexicon entry, multi-word ones included, in
+ * a single scan of the tweet, with no tokenization step.  Entries are
+ * compiled into an Aho-Corasick automaton stored as a double-array trie, over
+ * an alphabet in which case is folded and each run of bytes other than
+ * letters and digits reads as one space.  Entries are prefixed by a space, as
+ * the tweet is, so they only match from the start of a word, and are scored
+ * at the end of one.  Of two overlapping matches, as in "no fun", only the
+ * longest one is scored.
+ */
+class AhoCorasickClassifier {
+    static constexpr auto     default_path       = "AFINN-111.txt";
+    static constexpr uint8_t  space_symbol       = 1;
+    static constexpr unsigned alphabet_size      = 38;
+    static constexpr int32_t  root               = 0;
+    static constexpr size_t   max_recent_matches = 16;
+
+    struct Unit {
+        int32_t base  = 0;
+        int32_t check = -1;
+    };
+
+    /*
+     * The longest entry recognized in a state, if any.
+     */
+    struct Match {
+        uint8_t     length = 0;
+        signed char score  = 0;
+    };
+
+    struct ScoredMatch {
+        size_t start;
+        size_t end;
+        int    score;
+    };
+
+    vector<Unit>    units;
+    vector<int32_t> failures;
+    vector<Match>   matches;
+
+    int32_t get_transition(int32_t state, uint8_t symbol) const {
+        const size_t next = units[state].base + symbol;
+        return next < units.size() && units[next].check == state
+                   ? static_cast<int32_t>(next)
+                   : -1;
+    }
+
+    int32_t get_next_state(int32_t state, uint8_t symbol) const {
+        for (;;) {
+            const auto next = get_transition(state, symbol);
+            if (next >= 0) {
+                return next;
+            }
+            if (state == root) {
+                return root;
+            }
+            state = failures[state];
+        }
+    }
+
+    /*
+     * Return the symbols of a lexicon entry, starting with a space.
+     */
+    static vector<uint8_t> get_entry_symbols(string_view entry) {
+        vector<uint8_t> entry_symbols {space_symbol};
+        for (const char c : entry) {
+            const auto symbol = aho_corasick_symbols[static_cast<uint8_t>(c)];
+            if (symbol != space_symbol
+                || entry_symbols.back() != space_symbol) {
+                entry_symbols.push_back(symbol);
+            }
+        }
+        if (entry_symbols.back() == space_symbol) {
+            entry_symbols.pop_back();
+        }
+        return entry_symbols;
+    }
+
+    /*
+     * Return whether children, indexed by symbol, can all be placed in free
+     * units from base, growing the double array as needed.
+     */
+    bool can_place_children(const array<int32_t, alphabet_size> &children,
+                            size_t                                base) {
+        if (base + alphabet_size > units.size()) {
+            units.resize(base + alphabet_size);
+        }
+        for (unsigned symbol = 1; symbol < alphabet_size; ++symbol) {
+            if (children[symbol] != 0 && units[base + symbol].check >= 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Lay out the trie, given as a table of children per node, in the double
+     * array, placing each node's children at the first base where they fit.
+     * Nodes are placed shallowest first.  Return the state of each node.
+     */
+    vector<int32_t>
+    pack_trie(const vector<array<int32_t, alphabet_size>> &trie) {
+        /*
+         * Bases and symbols both start from 1, so no child ever lands in
+         * unit 0 or 1 and the search for free units starts from 2.
+         */
+        vector<int32_t> states(trie.size(), root);
+        vector<int32_t> nodes_by_depth {0};
+        size_t          first_free = 2;
+
+        units.resize(alphabet_size);
+        for (size_t i = 0; i < nodes_by_depth.size(); ++i) {
+            const auto node  = nodes_by_depth[i];
+            const auto state = states[node];
+            size_t     base  = first_free >= alphabet_size
+                                   ? first_free - (alphabet_size - 1)
+                                   : 1;
+            while (!can_place_children(trie[node], base)) {
+                ++base;
+            }
+
+            units[state].base = base;
+            for (unsigned symbol = 1; symbol < alphabet_size; ++symbol) {
+                const auto child = trie[node][symbol];
+                if (child != 0) {
+                    states[child]              = base + symbol;
+                    units[base + symbol].check = state;
+                    nodes_by_depth.push_back(child);
+                }
+            }
+            while (first_free < units.size()
+                   && units[first_free].check >= 0) {
+                ++first_free;
+            }
+        }
+        return states;
+    }
+
+public:
+    AhoCorasickClassifier(const char *path = default_path) {
+        vector<array<int32_t, alphabet_size>> trie(1);
+        vector<Match>                         trie_matches(1);
+        ifstream                              input_file {path};
+        string                                line;
+
+        while (input_file.good() && getline(input_file, line)) {
+            const auto line_fields = string_split(line, '\t');
+            assert(line_fields.size() == 2);
+
+            const auto score         = stoi(string {line_fields.back()});
+            const auto entry_symbols = get_entry_symbols(line_fields.front());
+            assert(score >= -128 && score <= 127);
+            assert(entry_symbols.size() <= UINT8_MAX);
+
+            int32_t node = 0;
+            for (const auto symbol : entry_symbols) {
+                if (trie[node][symbol] == 0) {
+                    trie[node][symbol] = trie.size();
+                    trie.emplace_back();
+                    trie_matches.emplace_back();
+                }
+                node = trie[node][symbol];
+            }
+            if (node != 0) {
+                trie_matches[node] = {
+                    static_cast<uint8_t>(entry_symbols.size()),
+                    static_cast<signed char>(score)};
+            }
+        }
+
+        const auto states = pack_trie(trie);
+        failures.assign(units.size(), root);
+        matches.assign(units.size(), Match {});
+        for (size_t node = 0; node < trie.size(); ++node) {
+            matches[states[node]] = trie_matches[node];
+        }
+
+        /*
+         * Nodes were packed shallowest first, so visiting states in the
+         * same order finds every failure target complete.
+         */
+        vector<int32_t> states_by_depth {root};
+        for (size_t i = 0; i < states_by_depth.size(); ++i) {
+            const auto state = states_by_depth[i];
+            for (unsigned symbol = 1; symbol < alphabet_size; ++symbol) {
+                const auto child = get_transition(state, symbol);
+                if (child < 0) {
+                    continue;
+                }
+                int32_t failure = root;
+                for (auto s = state; s != root;) {
+                    s                 = failures[s];
+                    const auto target = get_transition(s, symbol);
+                    if (target >= 0) {
+                        failure = target;
+                        break;
+                    }
+                }
+                failures[child] = failure;
+                if (matches[child].length == 0) {
+                    matches[child] = matches[failure];
+                }
+                states_by_depth.push_back(child);
+            }
+        }
+    }
+
+    SentimentResult classify(string_view tweet) const {
+        array<ScoredMatch, max_recent_matches> recent_matches;
+        size_t                                 recent_match_count = 0;
+
+        int     current_tweet_sentiment = 0;
+        int32_t state                   = get_next_state(root, space_symbol);
+        size_t  position                = 1;
+        bool    is_after_space          = true;
+
+        /*
+         * Score the longest entry ending at the current position, unless it
+         * overlaps a longer one already scored, in which case it is ignored;
+         * shorter ones it overlaps are discarded instead.
+         */
+        const auto score_match = [&] {
+            const auto &match = matches[state];
+            if (match.length == 0) {
+                return;
+            }
+            const size_t start             = position - match.length;
+            size_t       first_overlapping = recent_match_count;
+            while (first_overlapping > 0
+                   && recent_matches[first_overlapping - 1].end > start) {
+                --first_overlapping;
+            }
+            for (size_t i = first_overlapping; i < recent_match_count; ++i) {
+                const auto &recent = recent_matches[i];
+                if (recent.end - recent.start >= match.length) {
+                    return;
+                }
+            }
+            for (size_t i = first_overlapping; i < recent_match_count; ++i) {
+                current_tweet_sentiment -= recent_matches[i].score;
+            }
+            recent_match_count = first_overlapping;
+            if (recent_match_count == max_recent_matches) {
+                move(recent_matches.begin() + 1, recent_matches.end(),
+                     recent_matches.begin());
+                --recent_match_count;
+            }
+#ifndef NDEBUG
+            {
+                lock_guard lock {print_mutex};
+                clog << "[AHO-CORASICK CLASSIFIER] Matched an entry "
+                     << static_cast<unsigned>(match.length)
+                     << " symbols long, with score: "
+                     << static_cast<int>(match.score) << '\n';
+            }
+#endif
+            recent_matches[recent_match_count++] = {start, position,
+                                                    match.score};
+            current_tweet_sentiment += match.score;
+        };
+
+        for (const char c : tweet) {
+            const auto symbol = aho_corasick_symbols[static_cast<uint8_t>(c)];
+            if (symbol == space_symbol) {
+                if (is_after_space) {
+                    continue;
+                }
+                score_match();
+            }
+            is_after_space = symbol == space_symbol;
+            state          = get_next_state(state, symbol);
+            ++position;
+        }
+        if (!is_after_space) {
+            score_match();
+        }
+        return {score_to_sentiment(current_tweet_sentiment),
+                current_tweet_sentiment};
+    }
+};
+
+/*
+ * Add to each of the width sums the matching column of each of the count
+ * rows of matrix given by indices, width being a multiple of 32: the product
+ * of a sparse vector of binary features with a dense matrix.  With AVX2, 32
+ * sums stay in four registers while the rows are added, 16 with SSE2, so
+ * that four additions are always in flight.
+ */
+static inline void add_weight_rows(float *sums, const float *matrix,
+                                   size_t width, const uint32_t *indices,
+                                   size_t count) {
+    size_t column = 0;
+
+#if defined(__AVX2__)
+    for (; column + 32 <= width; column += 32) {
+        __m256 sums0 = _mm256_loadu_ps(sums + column);
+        __m256 sums1 = _mm256_loadu_ps(sums + column + 8);
+        __m256 sums2 = _mm256_loadu_ps(sums + column + 16);
+        __m256 sums3 = _mm256_loadu_ps(sums + column + 24);
+        for (size_t i = 0; i < count; ++i) {
+            const float *row = matrix + indices[i] * width + column;
+            sums0 = _mm256_add_ps(sums0, _mm256_loadu_ps(row));
+            sums1 = _mm256_add_ps(sums1, _mm256_loadu_ps(row + 8));
+            sums2 = _mm256_add_ps(sums2, _mm256_loadu_ps(row + 16));
+            sums3 = _mm256_add_ps(sums3, _mm256_loadu_ps(row + 24));
+        }
+        _mm256_storeu_ps(sums + column, sums0);
+        _mm256_storeu_ps(sums + column + 8, sums1);
+        _mm256_storeu_ps(sums + column + 16, sums2);
+        _mm256_storeu_ps(sums + column + 24, sums3);
+    }
+#elif defined(__SSE2__)
+    for (; column + 16 <= width; column += 16) {
+        __m128 sums0 = _mm_loadu_ps(sums + column);
+        __m128 sums1 = _mm_loadu_ps(sums + column + 4);
+        __m128 sums2 = _mm_loadu_ps(sums + column + 8);
+        __m128 sums3 = _mm_loadu_ps(sums + column + 12);
+        for (size_t i = 0; i < count; ++i) {
+            const float *row = matrix + indices[i] * width + column;
+            sums0 = _mm_add_ps(sums0, _mm_loadu_ps(row));
+            sums1 = _mm_add_ps(sums1, _mm_loadu_ps(row + 4));
+            sums2 = _mm_add_ps(sums2, _mm_loadu_ps(row + 8));
+            sums3 = _mm_add_ps(sums3, _mm_loadu_ps(row + 12));
+        }
+        _mm_storeu_ps(sums + column, sums0);
+        _mm_storeu_ps(sums + column + 4, sums1);
+        _mm_storeu_ps(sums + column + 8, sums2);
+        _mm_storeu_ps(sums + column + 12, sums3);
+    }
+#endif
+
+    for (; column < width; ++column) {
+        float sum = sums[column];
+        for (size_t i = 0; i < count; ++i) {
+            sum += matrix[indices[i] * width + column];
+        }
+        sums[column] = sum;
+    }
+}
+
+/*
+ * A multi-class naive Bayes model over hashed bag-of-words features, linear
+ * in log space.  Every word of a normalized tweet, and every pair of
+ * consecutive words, is hashed to one of 2^16 features, and each feature
+ * adds its row of log-likelihoods, one per class, to the tweet's.  The
+ * classes stand for scores spread evenly from -5 to 5, and the tweet's score
+ * is the mean of these, weighted by the posterior probability of each class,
+ * rounded.  Terms are read from a file of term and weight pairs separated by
+ * a tab, such as the AFINN lexicon, each term of one or two words being
+ * hashed the same way; longer terms are skipped, and terms sharing a feature
+ * add up their weights.  A term of weight w has a Gaussian log-likelihood of
+ * -(w - s)^2 / 2 in the class of score s; every other feature has a row of
+ * zeros, so that all words cost the same.  The cost of a tweet grows with
+ * the number of classes, which the command line sets.
+ */
+class LinearClassifier {
+    static constexpr auto     default_path    = "AFINN-111.txt";
+    static constexpr uint32_t dimensions      = 1 << 16;
+    static constexpr uint64_t pair_multiplier = 0x9e3779b97f4a7c15;
+    static constexpr float    max_score       = 5;
+
+    vector<uint16_t> rows_by_feature;
+    vector<float>    log_likelihoods;
+    vector<float>    class_sums;
+    vector<uint32_t> features;
+    string           normalized_text;
+    Normalization    normalization;
+    unsigned         classes;
+    size_t           row_width;
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccd;
+        x ^= x >> 33;
+        return x;
+    }
+
+    static uint64_t hash(string_view word) {
+        uint64_t h = 0xcbf29ce484222325;
+        for (const char c : word) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001b3;
+        }
+        return mix(h);
+    }
+
+    float get_class_score(unsigned class_index) const {
+        return -max_score + 2 * max_score * class_index / (classes - 1);
+    }
+
+    /*
+     * Call on_feature with the feature of every word of text, each followed
+     * by the one of the pair it ends, if any.  Return the number of words.
+     */
+    template<typename FeatureHandler>
+    size_t for_each_feature(string_view text, FeatureHandler on_feature) {
+        size_t   word_count    = 0;
+        uint64_t previous_hash = 0;
+
+        for_each_normalized_word(
+            normalization, text, normalized_text, [&](string_view word) {
+                const uint64_t word_hash = hash(word);
+                on_feature(static_cast<uint32_t>(word_hash)
+                           & (dimensions - 1));
+                if (word_count > 0) {
+                    const uint64_t pair_hash =
+                        mix(previous_hash * pair_multiplier + word_hash);
+                    on_feature(static_cast<uint32_t>(pair_hash)
+                               & (dimensions - 1));
+                }
+                previous_hash = word_hash;
+                ++word_count;
+            });
+        return word_count;
+    }
+
+public:
+    LinearClassifier(Normalization normalization = Normalization::Bytewise,
+                     unsigned      classes       = default_classifier_classes,
+                     const char *  path          = default_path)
+        : rows_by_feature(dimensions), normalization {normalization},
+          classes {classes}, row_width {(classes + 31) / 32 * 32} {
+        assert(classes >= 2 && classes <= max_classifier_classes);
+        ifstream      input_file {path};
+        string        line;
+        vector<float> term_weights {0};
+
+        while (input_file.good() && getline(input_file, line)) {
+            const auto line_fields = string_split(line, '\t');
+            assert(line_fields.size() == 2);
+
+            uint32_t   term_feature = 0;
+            const auto word_count   = for_each_feature(
+                line_fields.front(),
+                [&](uint32_t feature) { term_feature = feature; });
+            if (word_count != 1 && word_count != 2) {
+                continue;
+            }
+            auto &row = rows_by_feature[term_feature];
+            if (row == 0) {
+                if (term_weights.size() > UINT16_MAX) {
+                    cerr << "Error: too many terms in " << path << '\n';
+                    exit(EXIT_FAILURE);
+                }
+                row = term_weights.size();
+                term_weights.push_back(0);
+            }
+            term_weights[row] += stof(string {line_fields.back()});
+        }
+
+        log_likelihoods.resize(term_weights.size() * row_width);
+        for (size_t row = 1; row < term_weights.size(); ++row) {
+            for (unsigned c = 0; c < classes; ++c) {
+                const float distance =
+                    term_weights[row] - get_class_score(c);
+                log_likelihoods[row * row_width + c] =
+                    -distance * distance / 2;
+            }
+        }
+        class_sums.resize(row_width);
+    }
+
+    SentimentResult classify(string_view tweet) {
+        features.clear();
+        for_each_feature(tweet, [this](uint32_t feature) {
+            features.push_back(rows_by_feature[feature]);
+        });
+        fill(class_sums.begin(), class_sums.end(), 0.0f);
+        add_weight_rows(class_sums.data(), log_likelihoods.data(), row_width,
+                        features.data(), features.size());
+
+        /*
+         * Subtract the largest log-likelihood so that exp() cannot overflow.
+         */
+        const float largest_sum =
+            *max_element(class_sums.begin(), class_sums.begin() + classes);
+        float total_probability = 0;
+        float weighted_score    = 0;
+        for (unsigned c = 0; c < classes; ++c) {
+            const float probability = exp(class_sums[c] - largest_sum);
+            total_probability += probability;
+            weighted_score += probability * get_class_score(c);
+        }
+        const int current_tweet_sentiment =
+            static_cast<int>(lround(weighted_score / total_probability));
+#ifndef NDEBUG
+        {
+            lock_guard lock {print_mutex};
+            clog << "[LINEAR CLASSIFIER] Features: " << features.size()
+                 << ", classes: " << classes
+                 << ", with score: " << current_tweet_sentiment << '\n';
+        }
 #endif
-                current_tweet_sentiment += sentiment_entry->second;
-            }
-        }
         return {score_to_sentiment(current_tweet_sentiment),
                 current_tweet_sentiment};
     }
 };
 
+/*
+ * Score every tweet in the given file for the given number of rounds, once
+ * with split_in_words_in_place(), once with for_each_word() and once with
+ * for_each_utf8_word(), looking words up in the AFINN perfect hash table.
+ * Print how many tweet bytes each tokenizer gets through per cycle of the
+ * time stamp counter, including the copy of each tweet the first one has to
+ * modify.  The last one finds different words, hence a different score.
+ */
+static inline void run_tokenizer_benchmark(unsigned    rounds,
+                                           const char *path) {
+    const TweetCorpus tweets {path};
+    string            buffer;
+    size_t            total_bytes = 0;
+    for (const auto &tweet : tweets) {
+        total_bytes += tweet.text.size();
+    }
+    total_bytes *= rounds;
+
+    long                split_score = 0;
+    const unsigned long split_start = read_cycle_counter();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (const auto &tweet : tweets) {
+            buffer = tweet.text;
+            for (const auto &word : split_in_words_in_place(buffer)) {
+                split_score += afinn_lexicon.find(word).value_or(0);
+            }
+        }
+    }
+    const unsigned long split_cycles = read_cycle_counter() - split_start;
+
+    long                fused_score = 0;
+    const unsigned long fused_start = read_cycle_counter();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (const auto &tweet : tweets) {
+            for_each_word(tweet.text, buffer, [&](string_view word) {
+                fused_score += afinn_lexicon.find(word).value_or(0);
+            });
+        }
+    }
+    const unsigned long fused_cycles = read_cycle_counter() - fused_start;
+
+    long                utf8_score = 0;
+    const unsigned long utf8_start = read_cycle_counter();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (const auto &tweet : tweets) {
+            for_each_utf8_word(tweet.text, buffer, [&](string_view word) {
+                utf8_score += afinn_lexicon.find(word).value_or(0);
+            });
+        }
+    }
+    const unsigned long utf8_cycles = read_cycle_counter() - utf8_start;
+
+    if (split_score != fused_score) {
+        cerr << "Error: tokenizers disagree on the total score ("
+             << split_score << " against " << fused_score << ")\n";
+        exit(EXIT_FAILURE);
+    }
+    cout << "Tokenized " << total_bytes << " bytes in " << rounds
+         << " round" << (rounds == 1 ? "" : "s") << '\n'
+         << "Three-pass tokenizer:\t"
+         << total_bytes / static_cast<double>(split_cycles)
+         << " bytes per cycle\n"
+         << "Fused " << get_tokenizer_kernel_name() << " tokenizer:\t"
+         << total_bytes / static_cast<double>(fused_cycles)
+         << " bytes per cycle\n"
+         << "UTF-8 " << get_tokenizer_kernel_name() << " tokenizer:\t"
+         << total_bytes / static_cast<double>(utf8_cycles)
+         << " bytes per cycle (total score " << utf8_score << " against "
+         << fused_score << ")\n";
+}
+
 /*
  * Classifier operator internal logic.
  */
-template<typename Classifier>
+template<typename Classifier, typename Input = Tuple>
 class MapFunctor {
     Classifier classifier;
 
 public:
     MapFunctor() = default;
-    MapFunctor(const char *path) : classifier {path} {}
+    MapFunctor(const Classifier &classifier) : classifier {classifier} {}
 
-    void operator()(Tuple &tuple) const {
+    void operator()(Tuple &tuple) {
         tuple.result = classifier.classify(tuple.tweet);
+        tuple.trace.record_hop();
     }
 };
 
 /*
- * Sink operator internal logic.
+ * Classifier operator internal logic for batches, scoring all of their tweets
+ * in a row while the classifier's tables and buffers are still in cache.
  */
-class SinkFunctor {
-    vector<unsigned long> latency_samples;
-    vector<unsigned long> service_time_samples;
-    unsigned long         tuples_received    = 0;
-    unsigned long         last_sampling_time = current_time();
-    unsigned long         last_arrival_time  = last_sampling_time;
-    unsigned              sampling_rate;
+template<typename Classifier>
+class MapFunctor<Classifier, TweetBatch> {
+    Classifier classifier;
+
+public:
+    MapFunctor() = default;
+    MapFunctor(const Classifier &classifier) : classifier {classifier} {}
 
-    bool is_time_to_sample(unsigned long arrival_time) {
-        if (sampling_rate == 0) {
-            return true;
+    void operator()(TweetBatch &batch) {
+        const size_t size = batch.tweets.size();
+        batch.results.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            batch.results[i] = classifier.classify(batch.tweets[i]);
         }
-        const unsigned long time_since_last_sampling =
-            difference(arrival_time, last_sampling_time);
-        const unsigned long time_between_samples =
-            (1.0 / sampling_rate) * timeunit_scale_factor;
-        return time_since_last_sampling >= time_between_samples;
+        batch.trace.record_hop();
     }
+};
+
+/*
+ * Return the key the aggregator groups tuple by.
+ */
+static inline string_view get_window_key(const Tuple &tuple,
+                                         bool         key_by_hashtag) {
+    return key_by_hashtag ? get_first_hashtag(tuple.tweet) : tuple.author_id;
+}
+
+/*
+ * Aggregator operator internal logic, folding each classified tweet into
+ * every window of its key it belongs to as soon as it arrives, so that
+ * windows keep no tweets and closing one costs nothing.
+ */
+class AggregatorFunctor {
+    bool key_by_hashtag;
 
 public:
-    SinkFunctor(unsigned rate) : sampling_rate {rate} {}
+    AggregatorFunctor(bool key_by_hashtag) : key_by_hashtag {key_by_hashtag} {}
 
-    void operator()(optional<Tuple> &input) {
-        if (input) {
-            const unsigned long arrival_time = current_time();
-            const unsigned long latency =
-                difference(arrival_time, input->timestamp);
+    void operator()(const Tuple &tuple, SentimentWindow &window) {
+        if (window.count == 0) {
+            window.key = get_window_key(tuple, key_by_hashtag);
+        }
+        ++window.count;
+        window.score_sum += tuple.result.score;
+        if (tuple.result.sentiment == Sentiment::Positive) {
+            ++window.positive_count;
+        } else if (tuple.result.sentiment == Sentiment::Negative) {
+            ++window.negative_count;
+        }
+        if (tuple.timestamp >= window.timestamp) {
+            window.timestamp = tuple.timestamp;
+            window.trace     = tuple.trace.forwarded();
+        }
+    }
+};
+
+/*
+ * Sink operator internal logic.  Batches are unpacked, so that latencies are
+ * still sampled per tweet, while windows count as a single tuple each.
+ */
+template<typename Input>
+class SinkFunctor {
+    LatencySampler                  latency_samples;
+    HopSamples                      hop_samples;
+    optional<ReplicaCountersHandle> live_counters;
+    unsigned long                   tuples_received   = 0;
+    unsigned long                   last_arrival_time = current_time();
 
+    unsigned long receive(unsigned long timestamp, unsigned long arrival_time,
+                          bool is_measured) {
+        const unsigned long latency = difference(arrival_time, timestamp);
+
+        if (is_measured) {
             ++tuples_received;
-            last_arrival_time = arrival_time;
-            if (is_time_to_sample(arrival_time)) {
-                latency_samples.push_back(latency);
-                last_sampling_time = arrival_time;
+        }
+        live_counters->add_tuples();
+        if (latency_samples.should_sample(arrival_time)) {
+            if (is_measured) {
+                latency_samples.record(latency);
             }
+            live_counters->record_latency(latency);
+        }
+        return latency;
+    }
+
+    void receive_tweet([[maybe_unused]] string_view tweet,
+                       [[maybe_unused]] const SentimentResult &result,
+                       unsigned long timestamp, unsigned long arrival_time,
+                       bool is_measured) {
+        [[maybe_unused]] const unsigned long latency =
+            receive(timestamp, arrival_time, is_measured);
 #ifndef NDEBUG
-            {
-                lock_guard lock {print_mutex};
-                clog << "[SINK] arrival time: " << arrival_time
-                     << " ts:" << input->timestamp << " latency: " << latency
-                     << ", received tweet with score " << input->result.score
-                     << " and classification "
-                     << sentiment_to_string(input->result.sentiment)
-                     << " with contents after trimming: " << input->tweet
-                     << '\n';
-            }
+        {
+            lock_guard lock {print_mutex};
+            clog << "[SINK] arrival time: " << arrival_time
+                 << " ts:" << timestamp << " latency: " << latency
+                 << ", received tweet with score " << result.score
+                 << " and classification "
+                 << sentiment_to_string(result.sentiment)
+                 << " with contents: " << tweet << '\n';
+        }
 #endif
+    }
+
+    void receive_window(const SentimentWindow &window,
+                        unsigned long arrival_time, bool is_measured) {
+        [[maybe_unused]] const unsigned long latency =
+            receive(window.timestamp, arrival_time, is_measured);
+#ifndef NDEBUG
+        {
+            lock_guard lock {print_mutex};
+            clog << "[SINK] arrival time: " << arrival_time
+                 << " ts:" << window.timestamp << " latency: " << latency
+                 << ", received window of " << window.count
+                 << " tweets for key "
+                 << (window.key.empty() ? "<none>" : window.key)
+                 << " with mean score " << window.get_mean_score()
+                 << " and positive ratio " << window.get_positive_ratio()
+                 << '\n';
+        }
+#endif
+    }
+
+public:
+    SinkFunctor(const SamplingPolicy &policy) : latency_samples {policy} {}
+
+    void operator()(optional<Input> &input) {
+        if (!live_counters) {
+            live_counters = global_live_metrics.add_sink_replica();
+        }
+        if (input) {
+            const unsigned long arrival_time = current_time();
+            const bool          is_measured =
+                global_measurement_window.contains(arrival_time);
+            if (is_measured) {
+                hop_samples.record(input->trace);
+            }
+            if constexpr (is_same_v<Input, TweetBatch>) {
+                for (size_t i = 0; i < input->tweets.size(); ++i) {
+                    receive_tweet(input->tweets[i], input->results[i],
+                                  input->timestamps[i], arrival_time,
+                                  is_measured);
+                }
+            } else if constexpr (is_same_v<Input, SentimentWindow>) {
+                receive_window(*input, arrival_time, is_measured);
+            } else {
+                receive_tweet(input->tweet, input->result, input->timestamp,
+                              arrival_time, is_measured);
+            }
+            last_arrival_time = arrival_time;
         } else {
             global_received_tuples.fetch_add(tuples_received);
-            global_latency_metric.merge(latency_samples);
+            global_latency_metric.merge(latency_samples.get_samples());
+            global_hop_tracer.merge(hop_samples);
         }
     }
 };
 
 /*
- * Build the application PipeGraph according to the specified parameters.
+ * Add a classifier operator using copies of the given classifier on Input
+ * tuples to pipe.
+ */
+template<typename Input, typename Classifier>
+static inline MultiPipe &add_classifier(const Parameters &parameters,
+                                        MultiPipe &       pipe,
+                                        const Classifier &classifier) {
+    InstrumentedFunctor map_functor {
+        MapFunctor<Classifier, Input> {classifier}, "classifier",
+        global_operator_stats};
+    const auto          classifier_node =
+        Map_Builder {map_functor}
+            .withParallelism(parameters.parallelism[classifier_id])
+            .withName("classifier")
+            .withOutputBatchSize(parameters.batch_size[classifier_id])
+            .build();
+    return parameters.use_chaining ? pipe.chain(classifier_node)
+                                   : pipe.add(classifier_node);
+}
+
+/*
+ * Add the classifier operator selected by the command line parameters to
+ * pipe.
+ */
+template<typename Input>
+static inline MultiPipe &get_classifier_pipe(const Parameters &parameters,
+                                             MultiPipe &       pipe) {
+    const string name = parameters.classifier_type;
+    const auto   normalization =
+        get_normalization_from_string(parameters.normalization);
+
+    if (name == "basic") {
+        return add_classifier<Input>(parameters, pipe,
+                                     BasicClassifier {normalization});
+    } else if (name == "perfect-hash") {
+        return add_classifier<Input>(parameters, pipe,
+                                     PerfectHashClassifier {normalization});
+    } else if (name == "aho-corasick") {
+        return add_classifier<Input>(parameters, pipe,
+                                     AhoCorasickClassifier {});
+    } else if (name == "linear") {
+        return add_classifier<Input>(parameters, pipe,
+                                     LinearClassifier {
+                                         normalization,
+                                         parameters.classifier_classes});
+    } else {
+        cerr << "Error while building graph: unknown classifier type: "
+             << name << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * Add the aggregator operator, with the window and key selected by the
+ * command line parameters, to pipe.
+ */
+static inline MultiPipe &add_aggregator(const Parameters &parameters,
+                                        MultiPipe &       pipe) {
+    const auto window         = get_window_from_string(parameters.window);
+    const bool key_by_hashtag = string {parameters.window_key} == "hashtag";
+
+    InstrumentedFunctor aggregator_functor {
+        AggregatorFunctor {key_by_hashtag}, "aggregator",
+        global_operator_stats};
+    auto                builder =
+        Keyed_Windows_Builder {aggregator_functor}
+            .withParallelism(parameters.parallelism[aggregator_id])
+            .withName("aggregator")
+            .withOutputBatchSize(parameters.batch_size[aggregator_id])
+            .withKeyBy([key_by_hashtag](const Tuple &tuple) -> string_view {
+                return get_window_key(tuple, key_by_hashtag);
+            });
+    if (window.mode == WindowMode::Count) {
+        builder.withCBWindows(window.length, window.slide);
+    } else {
+        builder.withTBWindows(chrono::milliseconds {window.length},
+                              chrono::milliseconds {window.slide});
+    }
+    const auto aggregator_node = builder.build();
+    return parameters.use_chaining ? pipe.chain(aggregator_node)
+                                   : pipe.add(aggregator_node);
+}
+
+/*
+ * Build the application PipeGraph according to the specified parameters,
+ * with Input tuples flowing from the source to the classifier and Output
+ * tuples reaching the sink, through the aggregator when they are windows.
  * Return a reference to that same PipeGraph.
  */
+template<typename Input, typename Output = Input>
 static inline PipeGraph &build_graph(const Parameters &parameters,
                                      PipeGraph &       graph) {
-    SourceFunctor source_functor {parameters.duration, parameters.tuple_rate};
-    const auto    source =
+    SourceFunctor<Input> source_functor {
+        parameters.duration,
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration),
+        parameters.use_open_loop,
+        parameters.use_streaming,
+        parameters.parallelism[source_id],
+        parameters.tweets_per_tuple};
+    const auto           source =
         Source_Builder {source_functor}
             .withParallelism(parameters.parallelism[source_id])
             .withName("source")
             .withOutputBatchSize(parameters.batch_size[source_id])
             .build();
 
-    MapFunctor<BasicClassifier> map_functor;
-    const auto                  classifier_node =
-        Map_Builder {map_functor}
-            .withParallelism(parameters.parallelism[classifier_id])
-            .withName("classifier")
-            .withOutputBatchSize(parameters.batch_size[classifier_id])
+    InstrumentedFunctor sink_functor {
+        SinkFunctor<Output> {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink =
+        Sink_Builder {sink_functor}
+            .withParallelism(parameters.parallelism[sink_id])
+            .withName("sink")
             .build();
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink = Sink_Builder {sink_functor}
-                          .withParallelism(parameters.parallelism[sink_id])
-                          .withName("sink")
-                          .build();
-
+    auto &classifier_pipe =
+        get_classifier_pipe<Input>(parameters, graph.add_source(source));
+    auto &pipe = is_same_v<Output, SentimentWindow>
+                     ? add_aggregator(parameters, classifier_pipe)
+                     : classifier_pipe;
     if (parameters.use_chaining) {
-        graph.add_source(source).chain(classifier_node).chain_sink(sink);
+        pipe.chain_sink(sink);
     } else {
-        graph.add_source(source).add(classifier_node).add_sink(sink);
+        pipe.add_sink(sink);
     }
     return graph;
 }
 
+#if defined(NDEBUG) && !defined(PROFILE)
+static inline nlohmann::ordered_json
+add_sa_stats(const nlohmann::ordered_json &json_stats,
+             const Parameters &            parameters) {
+    auto updated_json_stats = json_stats;
+
+    updated_json_stats["classifier type"]    = parameters.classifier_type;
+    updated_json_stats["classifier classes"] = parameters.classifier_classes;
+    updated_json_stats["normalization"]      = parameters.normalization;
+    updated_json_stats["tweets per tuple"]   = parameters.tweets_per_tuple;
+    updated_json_stats["window"]             = parameters.window;
+    updated_json_stats["window key"]         = parameters.window_key;
+    return updated_json_stats;
+}
+#endif
+
 int main(int argc, char *argv[]) {
     Parameters parameters;
     parse_args(argc, argv, parameters);
     validate_args(parameters);
+    if (parameters.benchmark_rounds > 0) {
+        run_tokenizer_benchmark(parameters.benchmark_rounds,
+                                "tweetstream.jsonl");
+        return 0;
+    }
     print_initial_parameters(parameters);
 
+    global_thread_placement.assign("source", parameters.affinity[source_id]);
+    global_thread_placement.assign("classifier",
+                                   parameters.affinity[classifier_id]);
+    global_thread_placement.assign("aggregator",
+                                   parameters.affinity[aggregator_id]);
+    global_thread_placement.assign("sink", parameters.affinity[sink_id]);
+
     PipeGraph graph {"sa-sentiment-analysis", parameters.execution_mode,
                      parameters.time_policy};
-    build_graph(parameters, graph);
+    if (parameters.tweets_per_tuple > 1) {
+        build_graph<TweetBatch>(parameters, graph);
+    } else if (get_window_from_string(parameters.window).mode
+               != WindowMode::None) {
+        build_graph<Tuple, SentimentWindow>(parameters, graph);
+    } else {
+        build_graph<Tuple>(parameters, graph);
+    }
 
+    if (parameters.live_interval > 0) {
+        global_live_metrics.start(parameters.live_interval, "sa-live",
+                                  parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        global_operator_stats.enable(parameters.collect_perf_counters);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.enable(
+            get_sampling_policy_from_string(parameters.sampling_policy,
+                                            parameters.sampling_rate),
+            "sa");
+    }
+
+    global_measurement_window.start(
+        get_warmup_from_string(parameters.warmup, parameters.duration),
+        parameters.duration, global_live_metrics);
     const unsigned long start_time = current_time();
     graph.run();
     const unsigned long elapsed_time = difference(current_time(), start_time);
+    global_measurement_window.stop();
+    global_live_metrics.stop();
+    const unsigned long measured_time =
+        global_measurement_window.get_measured_time();
 
 #if defined(NDEBUG) && !defined(PROFILE)
     const double throughput =
-        elapsed_time > 0
-            ? (global_sent_tuples.load() / static_cast<double>(elapsed_time))
+        measured_time > 0
+            ? (global_sent_tuples.load() / static_cast<double>(measured_time))
             : global_sent_tuples.load();
 
     const double service_time = 1 / throughput;
 
-    const auto latency_stats = get_distribution_stats(
-        global_latency_metric, parameters, global_received_tuples);
+    const auto latency_stats =
+        add_sa_stats(get_distribution_stats(global_latency_metric, parameters,
+                                            global_received_tuples),
+                     parameters);
     serialize_json(latency_stats, "sa-latency",
                    parameters.metric_output_directory);
 
-    const auto throughput_stats = get_single_value_stats(
-        throughput, "throughput", parameters, global_sent_tuples.load());
+    const auto throughput_stats = add_sa_stats(
+        get_single_value_stats(throughput, "throughput", parameters,
+                               global_sent_tuples.load()),
+        parameters);
     serialize_json(throughput_stats, "sa-throughput",
                    parameters.metric_output_directory);
 
-    const auto service_time_stats = get_single_value_stats(
-        service_time, "service time", parameters, global_sent_tuples.load());
+    const auto service_time_stats = add_sa_stats(
+        get_single_value_stats(service_time, "service time", parameters,
+                               global_sent_tuples.load()),
+        parameters);
     serialize_json(service_time_stats, "sa-service-time",
                    parameters.metric_output_directory);
+
+    if (parameters.use_open_loop) {
+        const auto schedule_lag_stats = get_distribution_stats(
+            global_schedule_lag_metric, parameters, global_sent_tuples);
+        serialize_json(schedule_lag_stats, "sa-schedule-lag",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        const auto operator_stats = get_operator_stats(
+            global_operator_stats, "sa-operators", parameters);
+        serialize_json(operator_stats, "sa-operators",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.serialize(parameters);
+    }
 #endif
 
-    const double average_latency =
-        accumulate(global_latency_metric.begin(), global_latency_metric.end(),
-                   0.0)
-        / (!global_latency_metric.empty() ? global_latency_metric.size()
-                                          : 1.0);
-    print_statistics(elapsed_time, parameters.duration, global_sent_tuples,
-                     average_latency, global_received_tuples);
+    const double average_latency = global_latency_metric.mean();
+    print_statistics(elapsed_time, measured_time, parameters.duration,
+                     global_sent_tuples, average_latency,
+                     global_received_tuples);
     return 0;
 }
@@ -17,6 +17,7 @@
 #include <cstdlib>
 #include <functional>
 #include <getopt.h>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <numeric>
@@ -81,27 +82,39 @@ struct Parameters {
     Time_Policy_t    time_policy               = Time_Policy_t::INGRESS_TIME;
     unsigned         parallelism[num_nodes]    = {1, 1, 1, 1, 1, 1};
     unsigned         batch_size[num_nodes - 1] = {0, 0, 0, 0, 0};
-
-    unsigned rolling_counter_frequency     = 2;
-    unsigned intermediate_ranker_frequency = 2;
-    unsigned total_ranker_frequency        = 2;
-    unsigned duration                      = 60;
-    unsigned tuple_rate                    = 0;
-    unsigned sampling_rate                 = 100;
-    bool     use_chaining                  = false;
-    bool     use_timer_nodes               = true;
+    vector<unsigned> affinity[num_nodes];
+
+    unsigned     rolling_counter_frequency     = 2;
+    unsigned     intermediate_ranker_frequency = 2;
+    unsigned     total_ranker_frequency        = 2;
+    unsigned     duration                      = 60;
+    unsigned     tuple_rate                    = 0;
+    unsigned     sampling_rate                 = 100;
+    unsigned     live_interval                 = 0;
+    bool         use_chaining                  = false;
+    bool         use_timer_nodes               = true;
+    bool         collect_operator_stats        = false;
+    bool         use_streaming                 = false;
+    bool         use_tracing                   = false;
+    bool         collect_perf_counters         = false;
+    const char * sampling_policy               = "time";
+    const char * warmup                        = "none";
+    const char * load_profile                  = "constant";
+    bool         use_open_loop                 = false;
 };
 
 struct Tweet {
     string        id;
-    string        text;
+    string_view   text;
     unsigned long timestamp;
+    TupleTrace    trace {};
 };
 
 struct Topic {
     string        word;
     unsigned long parent_timestamp;
     bool          is_tick_tuple;
+    TupleTrace    trace {};
 };
 
 struct Counts {
@@ -110,6 +123,7 @@ struct Counts {
     size_t        window_length;
     unsigned long parent_timestamp;
     bool          is_tick_tuple;
+    TupleTrace    trace {};
 };
 
 static const struct option long_opts[] = {{"help", 0, 0, 'h'},
@@ -123,7 +137,17 @@ static const struct option long_opts[] = {{"help", 0, 0, 'h'},
                                           {"outputdir", 1, 0, 'o'},
                                           {"execmode", 1, 0, 'e'},
                                           {"timepolicy", 1, 0, 't'},
+                                          {"liveinterval", 1, 0, 'i'},
+                                          {"operatorstats", 1, 0, 'O'},
                                           {"timernodes", 1, 0, 'T'},
+                                          {"openloop", 1, 0, 'l'},
+                                          {"profile", 1, 0, 'L'},
+                                          {"warmup", 1, 0, 'w'},
+                                          {"samplingpolicy", 1, 0, 'S'},
+                                          {"perfcounters", 1, 0, 'C'},
+                                          {"affinity", 1, 0, 'A'},
+                                          {"tracing", 1, 0, 'H'},
+                                          {"streaming", 1, 0, 'm'},
                                           {0, 0, 0, 0}};
 
 template<typename T>
@@ -273,6 +297,7 @@ struct RankingsTuple {
     Rankings<string> rankings;
     unsigned long    parent_timestamp;
     bool             is_tick_tuple;
+    TupleTrace       trace {};
 };
 
 template<typename T>
@@ -428,25 +453,12 @@ static inline vector<string_view> string_split(const string_view &s,
     return words;
 }
 
-static inline vector<string> get_tweets_from_file(const char *filename) {
-    ifstream       twitterstream {filename};
-    vector<string> tweets;
-
-    while (twitterstream.good()) {
-        nlohmann::json new_tweet;
-        twitterstream >> new_tweet;
-        tweets.push_back(move(new_tweet["data"]["text"]));
-        twitterstream >> ws;
-    }
-    tweets.shrink_to_fit();
-    return tweets;
-}
-
 static inline void parse_args(int argc, char **argv, Parameters &parameters) {
     int option;
     int index;
 
-    while ((option = getopt_long(argc, argv, "r:s:p:b:c:d:f:o:e:t:T:h",
+    while ((option = getopt_long(argc, argv,
+                                 "r:s:p:b:c:d:f:o:e:t:i:O:T:l:L:w:S:C:A:H:m:h",
                                  long_opts, &index))
            != -1) {
         switch (option) {
@@ -493,6 +505,19 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
                 }
             }
         } break;
+        case 'A': {
+            const auto core_lists = get_affinity_from_string(optarg);
+            if (core_lists.size() != num_nodes) {
+                cerr << "Error in parsing the input arguments.  Affinity "
+                        "string requires exactly "
+                     << num_nodes << " core lists.\n";
+                exit(EXIT_FAILURE);
+            } else {
+                for (unsigned i = 0; i < num_nodes; ++i) {
+                    parameters.affinity[i] = core_lists[i];
+                }
+            }
+        } break;
         case 'c':
             parameters.use_chaining = get_bool_from_string(optarg);
             break;
@@ -508,16 +533,52 @@ static inline void parse_args(int argc, char **argv, Parameters &parameters) {
         case 't':
             parameters.time_policy = get_time_policy_from_string(optarg);
             break;
+        case 'i':
+            parameters.live_interval = atoi(optarg);
+            break;
+        case 'O':
+            parameters.collect_operator_stats = get_bool_from_string(optarg);
+            break;
         case 'T':
             parameters.use_timer_nodes = get_bool_from_string(optarg);
             break;
+        case 'l':
+            parameters.use_open_loop = get_bool_from_string(optarg);
+            break;
+        case 'L':
+            parameters.load_profile = optarg;
+            break;
+        case 'w':
+            parameters.warmup = optarg;
+            break;
+        case 'S':
+            parameters.sampling_policy = optarg;
+            break;
+        case 'C':
+            parameters.collect_perf_counters = get_bool_from_string(optarg);
+            break;
+        case 'H':
+            parameters.use_tracing = get_bool_from_string(optarg);
+            break;
+        case 'm':
+            parameters.use_streaming = get_bool_from_string(optarg);
+            break;
         case 'h':
             cout << "Parameters: --rate <value> --sampling "
                     "<value> --batch <size> --parallelism "
                     "<nSource,nTopicExtractor,nRollingCounter,"
                     "nIntermediateRanker,nTotalRanker,"
                     "nSink> [--duration <seconds>] "
-                    "[--chaining <value>]\n";
+                    "[--chaining <value>] [--liveinterval <msec>] "
+                    "[--operatorstats <value>] "
+                    "[--openloop <value>] "
+                    "[--profile <shape[,argument...]>] "
+                    "[--warmup <mode[,argument]>] "
+                    "[--samplingpolicy <policy[,argument]>] "
+                    "[--perfcounters <value>] "
+                    "[--affinity <cores,cores,...>] "
+                    "[--tracing <value>] "
+                    "[--streaming <value>]\n";
             exit(EXIT_SUCCESS);
         default:
             cerr << "Error in parsing the input arguments.  Use the --help "
@@ -540,6 +601,29 @@ static inline void validate_args(const Parameters &parameters) {
             exit(EXIT_FAILURE);
         }
     }
+
+    if (parameters.use_open_loop && parameters.tuple_rate == 0) {
+        cerr << "Error: open-loop generation requires a positive tuple "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if (string {parameters.load_profile} != "constant"
+        && parameters.tuple_rate == 0) {
+        cerr << "Error: load profiles other than constant need a positive "
+                "rate\n";
+        exit(EXIT_FAILURE);
+    }
+    if (parameters.tuple_rate > 0) {
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration);
+    }
+
+    get_warmup_from_string(parameters.warmup, parameters.duration);
+
+    get_sampling_policy_from_string(parameters.sampling_policy,
+                                    parameters.sampling_rate);
 }
 
 static inline void print_initial_parameters(const Parameters &parameters) {
@@ -598,6 +682,43 @@ static inline void print_initial_parameters(const Parameters &parameters) {
          << " seconds\n"
          << "Using additinoal WindFlow nodes for timers: "
          << (parameters.use_timer_nodes ? "yes" : "no") << '\n';
+
+    cout << "Live metrics interval:\t";
+    if (parameters.live_interval > 0) {
+        cout << parameters.live_interval << " ms\n";
+    } else {
+        cout << "disabled\n";
+    }
+
+    cout << "Per-operator statistics:\t"
+         << (parameters.collect_operator_stats ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Open-loop generation:\t"
+         << (parameters.use_open_loop ? "enabled" : "disabled") << '\n';
+
+    cout << "Load profile:\t" << parameters.load_profile << '\n';
+
+    cout << "Warm-up:\t" << parameters.warmup << '\n';
+
+    cout << "Sampling policy:\t" << parameters.sampling_policy << '\n';
+
+    cout << "Performance counters:\t"
+         << (parameters.collect_perf_counters ? "enabled" : "disabled")
+         << '\n';
+
+    cout << "Affinity:\t";
+    for (unsigned i = 0; i < num_nodes; ++i) {
+        cout << (i > 0 ? "," : "")
+             << get_string_from_core_list(parameters.affinity[i]);
+    }
+    cout << '\n';
+
+    cout << "Per-hop tracing:\t"
+         << (parameters.use_tracing ? "enabled" : "disabled") << '\n';
+
+    cout << "Tweet loading:\t"
+         << (parameters.use_streaming ? "streaming" : "indexed") << '\n';
 }
 
 /*
@@ -606,6 +727,9 @@ static inline void print_initial_parameters(const Parameters &parameters) {
 static atomic_ulong          global_sent_tuples {0};
 static atomic_ulong          global_received_tuples {0};
 static Metric<unsigned long> global_latency_metric {"tt-functors-latency"};
+static Metric<unsigned long> global_schedule_lag_metric {"tt-schedule-lag"};
+static LiveMetricsReporter   global_live_metrics;
+static OperatorStatsRegistry global_operator_stats;
 #ifndef NDEBUG
 static mutex print_mutex;
 #endif
@@ -737,16 +861,23 @@ public:
 };
 
 class SourceFunctor {
-    static constexpr auto default_path = "tweetstream.jsonl";
-    vector<string>        tweets;
-    unsigned long         duration;
-    unsigned              tuple_rate_per_second;
+    static constexpr auto        default_path = "tweetstream.jsonl";
+    shared_ptr<const TweetCorpus> tweets;
+    unsigned long                duration;
+    unsigned                     tuple_rate_per_second;
+    LoadProfile                  load_profile;
+    bool                         open_loop;
 
 public:
-    SourceFunctor(unsigned d, unsigned rate, const char *path = default_path)
-        : tweets {get_tweets_from_file(path)},
-          duration {d * timeunit_scale_factor}, tuple_rate_per_second {rate} {
-        if (tweets.empty()) {
+    SourceFunctor(unsigned d, const LoadProfile &profile,
+                  bool open_loop = false, bool streaming = false,
+                  unsigned parallelism = 1, const char *path = default_path)
+        : tweets {
+            make_shared<const TweetCorpus>(path, streaming, parallelism)},
+          duration {d * timeunit_scale_factor},
+          tuple_rate_per_second {static_cast<unsigned>(profile.base_rate)},
+          load_profile {profile}, open_loop {open_loop} {
+        if (tweets->empty()) {
             cerr << "Error: empty tweet stream.  Check whether dataset "
                     "file exists and is readable\n";
             exit(EXIT_FAILURE);
@@ -754,14 +885,23 @@ public:
     }
 
     void operator()(Source_Shipper<Tweet> &shipper, RuntimeContext &context) {
-        DO_NOT_WARN_IF_UNUSED(context);
-
-        const unsigned long end_time    = current_time() + duration;
-        unsigned long       sent_tuples = 0;
-        size_t              index       = 0;
+        global_thread_placement.pin_current_thread("source",
+                                                   context.getReplicaIndex());
+
+        SourceDeadline      deadline {duration, tuple_rate_per_second};
+        unsigned long       sent_tuples     = 0;
+        unsigned long       excluded_tuples = 0;
+        TweetReplayer       replayer {*tweets, context.getReplicaIndex()};
+        TraceSampler        trace_sampler;
+
+        auto live_counters = global_live_metrics.add_source_replica();
+        optional<RateController> rate_controller;
+        if (tuple_rate_per_second > 0) {
+            rate_controller.emplace(load_profile, open_loop);
+        }
 
-        while (current_time() < end_time) {
-            auto tweet = tweets[index];
+        while (!deadline.has_expired()) {
+            const auto tweet = replayer.next().text;
 #ifndef NDEBUG
             {
                 lock_guard lock {print_mutex};
@@ -769,18 +909,25 @@ public:
                      << "] Sending the following tweet: " << tweet << '\n';
             }
 #endif
-            const auto timestamp = current_time();
-            shipper.push({"", move(tweet), timestamp});
-            ++sent_tuples;
-            index = (index + 1) % tweets.size();
-
-            if (tuple_rate_per_second > 0) {
-                const unsigned long delay =
-                    (1.0 / tuple_rate_per_second) * timeunit_scale_factor;
-                busy_wait(delay);
+            const auto timestamp =
+                rate_controller
+                    ? rate_controller->wait_for_next_tuple(deadline)
+                    : current_time();
+            shipper.push({"", tweet, timestamp,
+                          trace_sampler.start_trace(timestamp)});
+            if (global_measurement_window.contains(timestamp)) {
+                ++sent_tuples;
+            } else {
+                ++excluded_tuples;
             }
+            live_counters.add_tuples();
         }
         global_sent_tuples.fetch_add(sent_tuples);
+        global_measurement_window.exclude_tuples(excluded_tuples);
+        if (open_loop) {
+            global_schedule_lag_metric.merge(
+                rate_controller->get_lag_samples());
+        }
     }
 };
 
@@ -802,7 +949,8 @@ struct TopicExtractorFunctor {
                              << "] Extracted topic: " << word << '\n';
                     }
 #endif
-                    shipper.push({string {word}, tweet.timestamp, false});
+                    shipper.push({string {word}, tweet.timestamp, false,
+                                  tweet.trace.forwarded()});
                 }
             }
         }
@@ -814,6 +962,7 @@ class RollingCounterFunctorWithTimerNode {
     SlidingWindowCounter<string> counter;
     NthLastModifiedTimeTracker   last_modified_tracker;
     optional<unsigned long>      parent_timestamp;
+    TupleTrace                   parent_trace;
 
     void ship_all(Shipper<Counts> &shipper, RuntimeContext &context) {
         DO_NOT_WARN_IF_UNUSED(context);
@@ -849,7 +998,7 @@ class RollingCounterFunctorWithTimerNode {
 #endif
             assert(parent_timestamp);
             shipper.push({word, count, actual_window_length_in_seconds,
-                          *parent_timestamp, false});
+                          *parent_timestamp, false, parent_trace.forwarded()});
         }
     }
 
@@ -878,6 +1027,7 @@ public:
             if (parent_timestamp) {
                 ship_all(shipper, context);
                 parent_timestamp.reset();
+                parent_trace = {};
             }
         } else {
 #ifndef NDEBUG
@@ -892,6 +1042,7 @@ public:
             if (!parent_timestamp) {
                 assert(topic.parent_timestamp > 0);
                 parent_timestamp = topic.parent_timestamp;
+                parent_trace     = topic.trace.received();
             }
         }
     }
@@ -903,6 +1054,7 @@ class RollingCounterFunctorWithTimerThread {
     SlidingWindowCounter<string> counter;
     NthLastModifiedTimeTracker   last_modified_tracker;
     optional<unsigned long>      parent_timestamp;
+    TupleTrace                   parent_trace;
     mutex                        emit_mutex;
     bool                         was_timer_thread_created = false;
 
@@ -923,6 +1075,7 @@ class RollingCounterFunctorWithTimerThread {
             if (parent_timestamp) {
                 ship_all(shipper, context);
                 parent_timestamp.reset();
+                parent_trace = {};
             }
         }
     }
@@ -960,7 +1113,7 @@ class RollingCounterFunctorWithTimerThread {
 #endif
             assert(parent_timestamp);
             shipper.push({word, count, actual_window_length_in_seconds,
-                          *parent_timestamp, false});
+                          *parent_timestamp, false, parent_trace.forwarded()});
         }
     }
 
@@ -981,7 +1134,8 @@ public:
           window_length_in_seconds {other.window_length_in_seconds},
           counter {other.counter},
           last_modified_tracker {other.last_modified_tracker},
-          parent_timestamp {other.parent_timestamp}, emit_mutex {} {}
+          parent_timestamp {other.parent_timestamp},
+          parent_trace {other.parent_trace}, emit_mutex {} {}
 
     void operator()(const Topic &topic, Shipper<Counts> &shipper,
                     RuntimeContext &context) {
@@ -998,6 +1152,7 @@ public:
         if (!parent_timestamp) {
             assert(topic.parent_timestamp > 0);
             parent_timestamp = topic.parent_timestamp;
+            parent_trace     = topic.trace.received();
         }
     }
 };
@@ -1008,6 +1163,7 @@ class RankerFunctorWithTimerNode {
     unsigned                count;
     Rankings<string>        rankings;
     optional<unsigned long> parent_timestamp;
+    TupleTrace              parent_trace;
 
 public:
     RankerFunctorWithTimerNode(unsigned count = 10) : count {count} {}
@@ -1026,8 +1182,10 @@ public:
             }
 #endif
             if (parent_timestamp) {
-                shipper.push({rankings, *parent_timestamp, false});
+                shipper.push({rankings, *parent_timestamp, false,
+                              parent_trace.forwarded()});
                 parent_timestamp.reset();
+                parent_trace = {};
             }
 #ifndef NDEBUG
             {
@@ -1041,6 +1199,7 @@ public:
             if (!parent_timestamp) {
                 assert(counts.parent_timestamp > 0);
                 parent_timestamp = counts.parent_timestamp;
+                parent_trace     = counts.trace.received();
             }
         }
     }
@@ -1054,6 +1213,7 @@ class RankerFunctorWithTimerThread {
     unsigned                count;
     Rankings<string>        rankings;
     optional<unsigned long> parent_timestamp;
+    TupleTrace              parent_trace;
     mutex                   emit_mutex;
     bool                    was_timer_thread_created = false;
 
@@ -1073,8 +1233,10 @@ class RankerFunctorWithTimerThread {
                          << '\n';
                 }
 #endif
-                shipper.push({rankings, *parent_timestamp, false});
+                shipper.push({rankings, *parent_timestamp, false,
+                              parent_trace.forwarded()});
                 parent_timestamp.reset();
+                parent_trace = {};
             }
         }
     }
@@ -1091,7 +1253,7 @@ public:
         : time_units_between_ticks {other.time_units_between_ticks},
           last_shipping_time {other.last_shipping_time}, count {other.count},
           rankings {other.rankings}, parent_timestamp {other.parent_timestamp},
-          emit_mutex {} {}
+          parent_trace {other.parent_trace}, emit_mutex {} {}
 
     void operator()(const InputType &counts, Shipper<RankingsTuple> &shipper,
                     RuntimeContext &context) {
@@ -1124,6 +1286,7 @@ public:
         if (!parent_timestamp) {
             assert(counts.parent_timestamp > 0);
             parent_timestamp = counts.parent_timestamp;
+            parent_trace     = counts.trace.received();
         }
     }
 };
@@ -1154,39 +1317,39 @@ using TotalRankerFunctorWithTimerThread =
     RankerFunctorWithTimerThread<RankingsTuple, update_total_rankings>;
 
 class SinkFunctor {
-    vector<unsigned long> latency_samples;
-    unsigned long         tuples_received    = 0;
-    unsigned long         last_sampling_time = current_time();
-    unsigned long         last_arrival_time  = last_sampling_time;
-    unsigned              sampling_rate;
-
-    bool is_time_to_sample(unsigned long arrival_time) {
-        if (sampling_rate == 0) {
-            return true;
-        }
-        const unsigned long time_since_last_sampling =
-            difference(arrival_time, last_sampling_time);
-        const unsigned long time_between_samples =
-            (1.0 / sampling_rate) * timeunit_scale_factor;
-        return time_since_last_sampling >= time_between_samples;
-    }
+    LatencySampler                  latency_samples;
+    HopSamples                      hop_samples;
+    optional<ReplicaCountersHandle> live_counters;
+    unsigned long                   tuples_received   = 0;
+    unsigned long                   last_arrival_time = current_time();
 
 public:
-    SinkFunctor(unsigned rate = 100) : sampling_rate {rate} {}
+    SinkFunctor(const SamplingPolicy &policy) : latency_samples {policy} {}
 
     void operator()(optional<RankingsTuple> &input, RuntimeContext &context) {
         DO_NOT_WARN_IF_UNUSED(context);
 
+        if (!live_counters) {
+            live_counters = global_live_metrics.add_sink_replica();
+        }
         if (input) {
             const unsigned long arrival_time = current_time();
             const unsigned long latency =
                 difference(arrival_time, input->parent_timestamp);
 
-            ++tuples_received;
+            const bool is_measured =
+                global_measurement_window.contains(arrival_time);
+            if (is_measured) {
+                ++tuples_received;
+                hop_samples.record(input->trace);
+            }
+            live_counters->add_tuples();
             last_arrival_time = arrival_time;
-            if (is_time_to_sample(arrival_time)) {
-                latency_samples.push_back(latency);
-                last_sampling_time = arrival_time;
+            if (latency_samples.should_sample(arrival_time)) {
+                if (is_measured) {
+                    latency_samples.record(latency);
+                }
+                live_counters->record_latency(latency);
             }
 #ifndef NDEBUG
             {
@@ -1201,14 +1364,21 @@ public:
 #endif
         } else {
             global_received_tuples.fetch_add(tuples_received);
-            global_latency_metric.merge(latency_samples);
+            global_latency_metric.merge(latency_samples.get_samples());
+            global_hop_tracer.merge(hop_samples);
         }
     }
 };
 
 static inline PipeGraph &
 build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
-    SourceFunctor source_functor {parameters.duration, parameters.tuple_rate};
+    SourceFunctor source_functor {
+        parameters.duration,
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration),
+        parameters.use_open_loop, parameters.use_streaming,
+        parameters.parallelism[source_id]};
     const auto    source =
         Source_Builder {source_functor}
             .withParallelism(parameters.parallelism[source_id])
@@ -1216,8 +1386,9 @@ build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
             .withOutputBatchSize(parameters.batch_size[source_id])
             .build();
 
-    TopicExtractorFunctor topic_extractor_functor;
-    const auto            topic_extractor_node =
+    InstrumentedFunctor topic_extractor_functor {
+        TopicExtractorFunctor {}, "topic extractor", global_operator_stats};
+    const auto topic_extractor_node =
         FlatMap_Builder {topic_extractor_functor}
             .withParallelism(parameters.parallelism[topic_extractor_id])
             .withName("topic extractor")
@@ -1234,8 +1405,10 @@ build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
             .withOutputBatchSize(0)
             .build();
 
-    RollingCounterFunctorWithTimerNode rolling_counter_functor {
-        300, parameters.intermediate_ranker_frequency};
+    InstrumentedFunctor rolling_counter_functor {
+        RollingCounterFunctorWithTimerNode {
+            300, parameters.intermediate_ranker_frequency},
+        "rolling counter", global_operator_stats};
     const auto rolling_counter_node =
         FlatMap_Builder {rolling_counter_functor}
             .withParallelism(parameters.parallelism[rolling_counter_id])
@@ -1257,8 +1430,10 @@ build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
             .withOutputBatchSize(0)
             .build();
 
-    IntermediateRankerFunctorWithTimerNode intermediate_ranker_functor;
-    const auto                             intermediate_ranker_node =
+    InstrumentedFunctor intermediate_ranker_functor {
+        IntermediateRankerFunctorWithTimerNode {}, "intermediate ranker",
+        global_operator_stats};
+    const auto intermediate_ranker_node =
         FlatMap_Builder {intermediate_ranker_functor}
             .withParallelism(parameters.parallelism[intermediate_ranker_id])
             .withName("intermediate ranker")
@@ -1279,19 +1454,25 @@ build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
             .withOutputBatchSize(1)
             .build();
 
-    TotalRankerFunctorWithTimerNode total_ranker_functor;
-    const auto                      total_ranker_node =
+    InstrumentedFunctor total_ranker_functor {
+        TotalRankerFunctorWithTimerNode {}, "total ranker",
+        global_operator_stats};
+    const auto total_ranker_node =
         FlatMap_Builder {total_ranker_functor}
             .withParallelism(parameters.parallelism[total_ranker_id])
             .withName("total ranker")
             .withOutputBatchSize(parameters.batch_size[total_ranker_id])
             .build();
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink = Sink_Builder {sink_functor}
-                          .withParallelism(parameters.parallelism[sink_id])
-                          .withName("sink")
-                          .build();
+    InstrumentedFunctor sink_functor {
+        SinkFunctor {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink =
+        Sink_Builder {sink_functor}
+            .withParallelism(parameters.parallelism[sink_id])
+            .withName("sink")
+            .build();
 
     if (parameters.use_chaining) {
         auto &topic_extractor_pipe =
@@ -1334,7 +1515,13 @@ build_graph_with_timer_nodes(const Parameters &parameters, PipeGraph &graph) {
 static inline PipeGraph &
 build_graph_with_timer_threads(const Parameters &parameters,
                                PipeGraph &       graph) {
-    SourceFunctor source_functor {parameters.duration, parameters.tuple_rate};
+    SourceFunctor source_functor {
+        parameters.duration,
+        get_load_profile_from_string(parameters.load_profile,
+                                     parameters.tuple_rate,
+                                     parameters.duration),
+        parameters.use_open_loop, parameters.use_streaming,
+        parameters.parallelism[source_id]};
     const auto    source =
         Source_Builder {source_functor}
             .withParallelism(parameters.parallelism[source_id])
@@ -1342,16 +1529,19 @@ build_graph_with_timer_threads(const Parameters &parameters,
             .withOutputBatchSize(parameters.batch_size[source_id])
             .build();
 
-    TopicExtractorFunctor topic_extractor_functor;
-    const auto            topic_extractor_node =
+    InstrumentedFunctor topic_extractor_functor {
+        TopicExtractorFunctor {}, "topic extractor", global_operator_stats};
+    const auto topic_extractor_node =
         FlatMap_Builder {topic_extractor_functor}
             .withParallelism(parameters.parallelism[topic_extractor_id])
             .withName("topic extractor")
             .withOutputBatchSize(parameters.batch_size[topic_extractor_id])
             .build();
 
-    RollingCounterFunctorWithTimerThread rolling_counter_functor {
-        parameters.rolling_counter_frequency};
+    InstrumentedFunctor rolling_counter_functor {
+        RollingCounterFunctorWithTimerThread {
+            parameters.rolling_counter_frequency},
+        "rolling counter", global_operator_stats};
     const auto rolling_counter_node =
         FlatMap_Builder {rolling_counter_functor}
             .withParallelism(parameters.parallelism[rolling_counter_id])
@@ -1360,8 +1550,10 @@ build_graph_with_timer_threads(const Parameters &parameters,
             .withKeyBy([](const Topic &topic) -> string { return topic.word; })
             .build();
 
-    IntermediateRankerFunctorWithTimerThread intermediate_ranker_functor {
-        parameters.intermediate_ranker_frequency};
+    InstrumentedFunctor intermediate_ranker_functor {
+        IntermediateRankerFunctorWithTimerThread {
+            parameters.intermediate_ranker_frequency},
+        "intermediate ranker", global_operator_stats};
     const auto intermediate_ranker_node =
         FlatMap_Builder {intermediate_ranker_functor}
             .withParallelism(parameters.parallelism[intermediate_ranker_id])
@@ -1371,8 +1563,9 @@ build_graph_with_timer_threads(const Parameters &parameters,
                 [](const Counts &count) -> string { return count.word; })
             .build();
 
-    TotalRankerFunctorWithTimerThread total_ranker_functor {
-        parameters.total_ranker_frequency};
+    InstrumentedFunctor total_ranker_functor {
+        TotalRankerFunctorWithTimerThread {parameters.total_ranker_frequency},
+        "total ranker", global_operator_stats};
     const auto total_ranker_node =
         FlatMap_Builder {total_ranker_functor}
             .withParallelism(parameters.parallelism[total_ranker_id])
@@ -1380,11 +1573,15 @@ build_graph_with_timer_threads(const Parameters &parameters,
             .withOutputBatchSize(parameters.batch_size[total_ranker_id])
             .build();
 
-    SinkFunctor sink_functor {parameters.sampling_rate};
-    const auto  sink = Sink_Builder {sink_functor}
-                          .withParallelism(parameters.parallelism[sink_id])
-                          .withName("sink")
-                          .build();
+    InstrumentedFunctor sink_functor {
+        SinkFunctor {get_sampling_policy_from_string(
+            parameters.sampling_policy, parameters.sampling_rate)},
+        "sink", global_operator_stats};
+    const auto          sink =
+        Sink_Builder {sink_functor}
+            .withParallelism(parameters.parallelism[sink_id])
+            .withName("sink")
+            .build();
 
     if (parameters.use_chaining) {
         graph.add_source(source)
@@ -1432,18 +1629,51 @@ int main(int argc, char *argv[]) {
     validate_args(parameters);
     print_initial_parameters(parameters);
 
+    global_thread_placement.assign("source", parameters.affinity[source_id]);
+    global_thread_placement.assign("topic extractor",
+                                   parameters.affinity[topic_extractor_id]);
+    global_thread_placement.assign("rolling counter",
+                                   parameters.affinity[rolling_counter_id]);
+    global_thread_placement.assign(
+        "intermediate ranker", parameters.affinity[intermediate_ranker_id]);
+    global_thread_placement.assign("total ranker",
+                                   parameters.affinity[total_ranker_id]);
+    global_thread_placement.assign("sink", parameters.affinity[sink_id]);
+
     PipeGraph graph {"tt-trending-topics", parameters.execution_mode,
                      parameters.time_policy};
     build_graph(parameters, graph);
 
+    if (parameters.live_interval > 0) {
+        global_live_metrics.start(parameters.live_interval, "tt-live",
+                                  parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        global_operator_stats.enable(parameters.collect_perf_counters);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.enable(
+            get_sampling_policy_from_string(parameters.sampling_policy,
+                                            parameters.sampling_rate),
+            "tt");
+    }
+
+    global_measurement_window.start(
+        get_warmup_from_string(parameters.warmup, parameters.duration),
+        parameters.duration, global_live_metrics);
     const unsigned long start_time = current_time();
     graph.run();
     const unsigned long elapsed_time = difference(current_time(), start_time);
+    global_measurement_window.stop();
+    global_live_metrics.stop();
+    const unsigned long measured_time =
+        global_measurement_window.get_measured_time();
 
 #if defined(NDEBUG) && !defined(PROFILE)
     const double throughput =
-        elapsed_time > 0
-            ? (global_sent_tuples.load() / static_cast<double>(elapsed_time))
+        measured_time > 0
+            ? (global_sent_tuples.load() / static_cast<double>(measured_time))
             : global_sent_tuples.load();
 
     const double service_time = 1 / throughput;
@@ -1468,14 +1698,28 @@ int main(int argc, char *argv[]) {
                      parameters);
     serialize_json(service_time_stats, "tt-service-time",
                    parameters.metric_output_directory);
+
+    if (parameters.use_open_loop) {
+        const auto schedule_lag_stats = get_distribution_stats(
+            global_schedule_lag_metric, parameters, global_sent_tuples);
+        serialize_json(schedule_lag_stats, "tt-schedule-lag",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.collect_operator_stats
+        || parameters.collect_perf_counters) {
+        const auto operator_stats = get_operator_stats(
+            global_operator_stats, "tt-operators", parameters);
+        serialize_json(operator_stats, "tt-operators",
+                       parameters.metric_output_directory);
+    }
+    if (parameters.use_tracing) {
+        global_hop_tracer.serialize(parameters);
+    }
 #endif
 
-    const double average_latency =
-        accumulate(global_latency_metric.begin(), global_latency_metric.end(),
-                   0.0)
-        / (!global_latency_metric.empty() ? global_latency_metric.size()
-                                          : 1.0);
-    print_statistics(elapsed_time, parameters.duration, global_sent_tuples,
-                     average_latency, global_received_tuples);
+    const double average_latency = global_latency_metric.mean();
+    print_statistics(elapsed_time, measured_time, parameters.duration,
+                     global_sent_tuples, average_latency,
+                     global_received_tuples);
     return 0;
 }
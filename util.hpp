@@ -14,21 +14,56 @@
 #define UTIL_HPP
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <numeric>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <random>
 #include <string>
 #include <string_view>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -56,17 +91,125 @@
 
 #define DO_NOT_WARN_IF_UNUSED(x) ((void) (x))
 
-static constexpr auto current_time = wf::current_time_nsecs;
+/*
+ * Conversion from invariant TSC ticks to nanoseconds, measured against
+ * wf::current_time_nsecs() the first time the clock is read so that both
+ * clocks share the same epoch.  If the CPU has no invariant TSC, usable is
+ * false and current_time_tsc_nsecs() falls back to wf::current_time_nsecs().
+ */
+struct TscCalibration {
+    bool          usable         = false;
+    unsigned long base_ticks     = 0;
+    unsigned long base_nsecs     = 0;
+    double        nsecs_per_tick = 0.0;
+};
+
+static inline bool has_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) {
+        return false;
+    }
+    __cpuid(0x80000007, eax, ebx, ecx, edx);
+    return edx & (1U << 8);
+#else
+    return false;
+#endif
+}
+
+/*
+ * Busy wait for about calibration_nsecs and derive the TSC frequency from
+ * the ticks elapsed in the meantime.  Each reference reading is taken
+ * between two TSC reads, keeping the tightest of a few attempts and using
+ * the midpoint of its TSC reads as its tick count.
+ */
+static inline TscCalibration calibrate_tsc() {
+    TscCalibration calibration;
+#if defined(__x86_64__) || defined(__i386__)
+    if (!has_invariant_tsc()) {
+        return calibration;
+    }
+    constexpr unsigned long calibration_nsecs = 50000000;
+    constexpr unsigned      attempts          = 16;
+
+    const auto take_reading = [](unsigned long &ticks, unsigned long &nsecs) {
+        unsigned long best_width = std::numeric_limits<unsigned long>::max();
+        for (unsigned i = 0; i < attempts; ++i) {
+            const unsigned long before = __rdtsc();
+            const unsigned long now    = wf::current_time_nsecs();
+            const unsigned long after  = __rdtsc();
+            if (after - before < best_width) {
+                best_width = after - before;
+                ticks      = before + best_width / 2;
+                nsecs      = now;
+            }
+        }
+    };
+
+    unsigned long start_ticks = 0, start_nsecs = 0;
+    unsigned long end_ticks = 0, end_nsecs = 0;
+    take_reading(start_ticks, start_nsecs);
+    do {
+        take_reading(end_ticks, end_nsecs);
+    } while (end_nsecs - start_nsecs < calibration_nsecs);
+
+    if (end_ticks > start_ticks) {
+        const double elapsed_nsecs = end_nsecs - start_nsecs;
+        calibration.usable         = true;
+        calibration.base_ticks     = start_ticks;
+        calibration.base_nsecs     = start_nsecs;
+        calibration.nsecs_per_tick = elapsed_nsecs / (end_ticks - start_ticks);
+    }
+#endif
+    return calibration;
+}
+
+/*
+ * Calibrate on first use rather than during static initialization, so that
+ * runs that stop early, as with --help or invalid arguments, do not busy
+ * wait.  Every application reads the clock once before running its graph.
+ */
+static inline const TscCalibration &get_tsc_calibration() {
+    static const TscCalibration calibration = calibrate_tsc();
+    return calibration;
+}
+
+/*
+ * Drop-in replacement for wf::current_time_nsecs() that only costs a TSC
+ * read and a multiplication on machines with an invariant TSC.
+ */
+static inline uint64_t current_time_tsc_nsecs() {
+#if defined(__x86_64__) || defined(__i386__)
+    const auto &calibration = get_tsc_calibration();
+    if (calibration.usable) {
+        const unsigned long ticks = __rdtsc() - calibration.base_ticks;
+        return calibration.base_nsecs
+               + static_cast<unsigned long>(ticks
+                                            * calibration.nsecs_per_tick);
+    }
+#endif
+    return wf::current_time_nsecs();
+}
+
+/*
+ * The clock used by every application.  Switch it to wf::current_time_nsecs
+ * or wf::current_time_usecs to bypass the TSC.
+ */
+static constexpr auto current_time = current_time_tsc_nsecs;
 
 static const auto timeunit_string =
-    current_time == wf::current_time_usecs   ? "microsecond"
-    : current_time == wf::current_time_nsecs ? "nanosecond"
-                                             : "time unit";
+    current_time == wf::current_time_usecs ? "microsecond"
+    : current_time == wf::current_time_nsecs
+            || current_time == current_time_tsc_nsecs
+        ? "nanosecond"
+        : "time unit";
 
 static const unsigned long timeunit_scale_factor =
-    current_time == wf::current_time_usecs   ? 1000000
-    : current_time == wf::current_time_nsecs ? 1000000000
-                                             : 1;
+    current_time == wf::current_time_usecs ? 1000000
+    : current_time == wf::current_time_nsecs
+            || current_time == current_time_tsc_nsecs
+        ? 1000000000
+        : 1;
 
 static uint64_t current_time_secs() {
     struct timespec t;
@@ -83,15 +226,43 @@ static unsigned long difference(unsigned long a, unsigned long b) {
 }
 
 /*
- * Suspend execution for an amount of time units specified by duration.
+ * End-of-run check for source loops that only reads the clock once every
+ * check_interval iterations.  Unthrottled sources check every 64 tuples;
+ * rate-limited ones check about once per millisecond of scheduled sends,
+ * so that they never overrun the deadline by much.
  */
-static inline void busy_wait(unsigned long duration) {
-    const unsigned long start_time = current_time();
-    unsigned long       now        = start_time;
-    while (now - start_time < duration) {
-        now = current_time();
+class SourceDeadline {
+    unsigned long end_time;
+    unsigned      check_interval;
+    unsigned      iterations_until_check = 0;
+
+public:
+    SourceDeadline(unsigned long duration, unsigned tuple_rate_per_second)
+        : end_time {current_time() + duration},
+          check_interval {tuple_rate_per_second == 0
+                              ? 64
+                              : std::max(1U, tuple_rate_per_second / 1000)} {}
+
+    bool has_expired() {
+        if (iterations_until_check > 0) {
+            --iterations_until_check;
+            return false;
+        }
+        iterations_until_check = check_interval - 1;
+        return current_time() >= end_time;
     }
-}
+
+    unsigned long get_end_time() const {
+        return end_time;
+    }
+
+    /*
+     * Make the next has_expired() call read the clock.
+     */
+    void check_on_next_call() {
+        iterations_until_check = 0;
+    }
+};
 
 /*
  * Return a std::vector of std::string_views, obtained from splitting the
@@ -198,41 +369,189 @@ static inline bool get_bool_from_string(const std::string &arg) {
                                    : false;
 }
 
+/*
+ * Return the numeric arguments following the name in a "name,argument..."
+ * command line specification, exiting on anything that is not a
+ * non-negative number.
+ */
+static inline std::vector<double>
+get_spec_arguments(const std::vector<std::string_view> &fields,
+                   const char *                         caller) {
+    std::vector<double> arguments;
+    for (std::size_t i = 1; i < fields.size(); ++i) {
+        const std::string field {fields[i]};
+        char *            end   = nullptr;
+        const double      value = std::strtod(field.c_str(), &end);
+        if (*end != '\0' || value < 0.0) {
+            std::cerr << caller << ":  error, invalid argument " << field
+                      << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+        arguments.push_back(value);
+    }
+    return arguments;
+}
+
+/*
+ * Log-linear (HDR-style) histogram of unsigned values.  Values smaller than
+ * 2^sub_bucket_bits are counted exactly, larger ones fall into buckets whose
+ * width doubles at every power of two, so that any reported value is within
+ * a relative error of 2^-(sub_bucket_bits - 1) of the recorded one.  The
+ * amount of memory used is fixed at construction time and recording a value
+ * never allocates, so each replica can fill its own histogram without any
+ * locking.  Merging two histograms takes time proportional to the number of
+ * buckets, regardless of how many values were recorded.
+ */
+template<typename T>
+class Histogram {
+    static_assert(std::is_unsigned_v<T>,
+                  "Histogram can only hold unsigned integral values");
+
+    static constexpr unsigned    sub_bucket_bits  = 8;
+    static constexpr unsigned    value_bits       = sizeof(T) * 8;
+    static constexpr std::size_t sub_bucket_count = 1UL << sub_bucket_bits;
+    static constexpr std::size_t half_sub_bucket_count = sub_bucket_count / 2;
+
+public:
+    static constexpr std::size_t bucket_count =
+        sub_bucket_count
+        + (value_bits - sub_bucket_bits) * half_sub_bucket_count;
+
+    static std::size_t bucket_index(T value) {
+        if (value < sub_bucket_count) {
+            return value;
+        }
+        const unsigned most_significant_bit =
+            63 - __builtin_clzll(static_cast<unsigned long long>(value));
+        const unsigned shift = most_significant_bit - sub_bucket_bits + 1;
+        return sub_bucket_count + (shift - 1) * half_sub_bucket_count
+               + ((value >> shift) - half_sub_bucket_count);
+    }
+
+    /*
+     * Return the value in the middle of the range covered by a bucket.
+     */
+    static T bucket_value(std::size_t index) {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        const std::size_t offset = index - sub_bucket_count;
+        const unsigned    shift  = offset / half_sub_bucket_count + 1;
+        const T           lower_bound =
+            static_cast<T>(offset % half_sub_bucket_count
+                           + half_sub_bucket_count)
+            << shift;
+        return lower_bound + ((T {1} << shift) - 1) / 2;
+    }
+
+private:
+    std::vector<unsigned long> counts;
+    unsigned long              total_count = 0;
+    unsigned long long         value_sum   = 0;
+    T                          min_value   = std::numeric_limits<T>::max();
+    T                          max_value   = 0;
+
+public:
+    Histogram() : counts(bucket_count) {}
+
+    /*
+     * Record value as if it was observed count times.
+     */
+    void record(T value, unsigned long count = 1) {
+        if (count == 0) {
+            return;
+        }
+        counts[bucket_index(value)] += count;
+        total_count += count;
+        value_sum += static_cast<unsigned long long>(value) * count;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+
+    Histogram &merge(const Histogram &other) {
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total_count += other.total_count;
+        value_sum += other.value_sum;
+        min_value = std::min(min_value, other.min_value);
+        max_value = std::max(max_value, other.max_value);
+        return *this;
+    }
+
+    std::size_t size() const {
+        return total_count;
+    }
+
+    bool empty() const {
+        return total_count == 0;
+    }
+
+    double mean() const {
+        return total_count > 0 ? value_sum / static_cast<double>(total_count)
+                               : 0.0;
+    }
+
+    /*
+     * Return the value found at position (size() - 1) * percentile among
+     * the recorded values, as if they were sorted.  The smallest and largest
+     * values are always reported exactly.
+     */
+    T percentile(double percentile) const {
+        if (total_count == 0) {
+            return 0;
+        }
+        if (percentile <= 0.0) {
+            return min_value;
+        }
+        if (percentile >= 1.0) {
+            return max_value;
+        }
+        const unsigned long rank = (total_count - 1) * percentile;
+        unsigned long       seen = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                return std::clamp(bucket_value(i), min_value, max_value);
+            }
+        }
+        return max_value;
+    }
+};
+
+/*
+ * A named histogram that sink replicas merge their own samples into once they
+ * are done.
+ */
 template<typename T>
 class Metric {
-    std::vector<T> sorted_samples;
-    std::string    metric_name;
-    std::mutex     metric_mutex;
+    Histogram<T> histogram;
+    std::string  metric_name;
+    std::mutex   metric_mutex;
 
 public:
     Metric(const std::string &name = "name") : metric_name {name} {}
 
-    Metric &merge(const std::vector<T> &new_samples) {
+    Metric &merge(const Histogram<T> &new_samples) {
         std::lock_guard guard {metric_mutex};
-        sorted_samples.insert(sorted_samples.begin(), new_samples.begin(),
-                              new_samples.end());
-        sort(sorted_samples.begin(), sorted_samples.end());
+        histogram.merge(new_samples);
         return *this;
     }
 
     std::size_t size() const {
-        return sorted_samples.size();
-    }
-
-    std::size_t length() const {
-        return sorted_samples.length();
+        return histogram.size();
     }
 
     bool empty() const {
-        return sorted_samples.empty();
+        return histogram.empty();
     }
 
-    typename std::vector<T>::const_iterator begin() const {
-        return sorted_samples.begin();
+    double mean() const {
+        return histogram.mean();
     }
 
-    typename std::vector<T>::const_iterator end() const {
-        return sorted_samples.end();
+    T percentile(double percentile) const {
+        return histogram.percentile(percentile);
     }
 
     const char *name() const {
@@ -240,117 +559,2688 @@ public:
     }
 };
 
-static inline void create_directory_if_not_exists(const char *path) noexcept {
-    const auto dir = opendir(path);
-    if (dir) {
-        const int status = closedir(dir);
-        if (status != 0) {
-            std::cerr << "Error closing directory " << path << '\n';
-            std::exit(EXIT_FAILURE);
-        }
+enum class SamplingMode { Time, OneInN, Reservoir };
+
+/*
+ * Which latencies sink replicas keep: at most rate per second (every one if
+ * rate is 0), each one with probability 1 / n, or a uniform sample of
+ * reservoir_size of them over the whole run.
+ */
+struct SamplingPolicy {
+    SamplingMode  mode           = SamplingMode::Time;
+    unsigned      rate           = 0;
+    unsigned long n              = 1;
+    std::size_t   reservoir_size = 0;
+};
+
+/*
+ * Parse a sampling policy given as time, one-in,<n> or reservoir,<size> on
+ * the command line.  The time policy samples at the given rate.
+ */
+static inline SamplingPolicy
+get_sampling_policy_from_string(const std::string &s, unsigned rate) {
+    const auto fields = string_split(s, ',');
+    const auto arguments =
+        get_spec_arguments(fields, "get_sampling_policy_from_string");
+    const std::string mode = fields.empty() ? "" : std::string {fields[0]};
+    SamplingPolicy    policy;
+    policy.rate = rate;
+
+    if (mode == "time" && arguments.empty()) {
+        policy.mode = SamplingMode::Time;
+    } else if (mode == "one-in" && arguments.size() == 1
+               && arguments[0] >= 1.0) {
+        policy.mode = SamplingMode::OneInN;
+        policy.n    = arguments[0];
+    } else if (mode == "reservoir" && arguments.size() == 1
+               && arguments[0] >= 1.0) {
+        policy.mode           = SamplingMode::Reservoir;
+        policy.reservoir_size = arguments[0];
     } else {
-        const int status = mkdir(path, S_IRWXU | S_IRGRP | S_IROTH);
-        if (status != 0) {
-            std::cerr << "Error creating directory\n";
-            std::exit(EXIT_FAILURE);
-        }
+        std::cerr << "get_sampling_policy_from_string:  error, invalid "
+                     "sampling policy\n";
+        std::exit(EXIT_FAILURE);
     }
+    return policy;
 }
 
-template<typename Parameters>
-static inline nlohmann::ordered_json
-get_distribution_stats(const Metric<unsigned long> &metric,
-                       const Parameters &           parameters,
-                       unsigned long                total_measurements) {
-    nlohmann::ordered_json json_stats;
-    json_stats["date"]                 = get_datetime_string();
-    json_stats["name"]                 = metric.name();
-    json_stats["time policy"]          = parameters.time_policy;
-    json_stats["parallelism"]          = parameters.parallelism;
-    json_stats["batch size"]           = parameters.batch_size;
-    json_stats["duration"]             = parameters.duration;
-    json_stats["tuple rate"]           = parameters.tuple_rate;
-    json_stats["sampling rate"]        = parameters.sampling_rate;
-    json_stats["chaining enabled"]     = parameters.use_chaining;
-    json_stats["time unit"]            = std::string {timeunit_string} + 's';
-    json_stats["sampled measurements"] = metric.size();
-    json_stats["total measurements"]   = total_measurements;
+/*
+ * Latency samples of a single sink replica, kept according to a
+ * SamplingPolicy.  All memory is allocated at construction, so neither
+ * should_sample() nor record() ever allocates, whatever the length of the
+ * run.  The random number generator is only used once per sampled value in
+ * the 1-in-n policy, thanks to geometrically distributed skips, and once per
+ * replaced value in the reservoir policy, which follows Algorithm L.
+ */
+class LatencySampler {
+    SamplingPolicy             policy;
+    Histogram<unsigned long>   histogram;
+    std::vector<unsigned long> reservoir;
+    unsigned long              last_sampling_time = 0;
+    unsigned long              time_between_samples;
+    unsigned long              tuples_to_skip = 0;
+    unsigned long              seen_values    = 0;
+    unsigned long              next_replaced  = 0;
+    double                     reservoir_weight = 0.0;
+    std::mt19937_64            generator;
+    bool                       is_seeded = false;
 
-    json_stats["execution mode"] =
-        get_string_from_execution_mode(parameters.execution_mode);
-    json_stats["time policy"] =
-        get_string_from_time_policy(parameters.time_policy);
+    /*
+     * Return a number in (0, 1).  Replicas are copies of the same functor,
+     * so each one seeds its own generator on first use.
+     */
+    double get_uniform() {
+        if (!is_seeded) {
+            generator.seed(std::random_device {}());
+            is_seeded = true;
+        }
+        return std::uniform_real_distribution<double> {
+            std::numeric_limits<double>::min(), 1.0}(generator);
+    }
 
-    if (!metric.empty()) {
-        const double mean =
-            accumulate(metric.begin(), metric.end(), 0.0) / metric.size();
-        json_stats["mean"] = mean;
+    /*
+     * Number of values to let through before the next one is taken, when
+     * each value is taken with the given probability.
+     */
+    unsigned long get_geometric_skip(double probability) {
+        return probability >= 1.0 ? 0
+                                  : std::floor(std::log(get_uniform())
+                                               / std::log1p(-probability));
+    }
 
-        for (const auto percentile : {0.0, 0.05, 0.25, 0.5, 0.75, 0.95, 1.0}) {
-            const auto percentile_value_position =
-                metric.begin() + (metric.size() - 1) * percentile;
-            const auto label =
-                std::to_string(static_cast<int>(percentile * 100))
-                + "th percentile";
-            json_stats[label] = *percentile_value_position;
+    void advance_reservoir() {
+        reservoir_weight *=
+            std::exp(std::log(get_uniform()) / reservoir.size());
+        next_replaced += get_geometric_skip(reservoir_weight) + 1;
+    }
+
+public:
+    LatencySampler(const SamplingPolicy &policy = {})
+        : policy {policy},
+          time_between_samples {policy.rate > 0 ? timeunit_scale_factor
+                                                      / policy.rate
+                                                : 0} {
+        if (policy.mode == SamplingMode::Reservoir) {
+            reservoir.reserve(policy.reservoir_size);
         }
-    } else {
-        json_stats["mean"] = 0;
-        for (const auto percentile : {"0", "25", "50", "75", "95", "100"}) {
-            const auto label  = std::string {percentile} + "th percentile";
-            json_stats[label] = 0;
+    }
+
+    /*
+     * Return whether the latency of a tuple arriving at the given time
+     * should be passed to record().  The reservoir policy looks at every
+     * latency, and decides in record() which ones to keep.
+     */
+    bool should_sample(unsigned long arrival_time) {
+        switch (policy.mode) {
+        case SamplingMode::Time:
+            if (difference(arrival_time, last_sampling_time)
+                < time_between_samples) {
+                return false;
+            }
+            last_sampling_time = arrival_time;
+            return true;
+        case SamplingMode::OneInN:
+            if (tuples_to_skip > 0) {
+                --tuples_to_skip;
+                return false;
+            }
+            tuples_to_skip = get_geometric_skip(1.0 / policy.n);
+            return true;
+        case SamplingMode::Reservoir:
+            return true;
         }
+        return true;
     }
 
-    return json_stats;
-}
+    void record(unsigned long latency) {
+        if (policy.mode != SamplingMode::Reservoir) {
+            histogram.record(latency);
+            return;
+        }
+        if (reservoir.size() < policy.reservoir_size) {
+            reservoir.push_back(latency);
+            if (reservoir.size() == policy.reservoir_size) {
+                reservoir_weight = 1.0;
+                next_replaced    = seen_values;
+                advance_reservoir();
+            }
+        } else if (seen_values == next_replaced) {
+            const auto index = static_cast<std::size_t>(get_uniform()
+                                                        * reservoir.size());
+            reservoir[std::min(index, reservoir.size() - 1)] = latency;
+            advance_reservoir();
+        }
+        ++seen_values;
+    }
 
-template<typename T, typename Parameters>
-static inline nlohmann::ordered_json
-get_single_value_stats(T value, const std::string &name,
-                       const Parameters &parameters,
-                       unsigned long     total_measurements) {
-    nlohmann::ordered_json json_stats;
-    json_stats["date"]               = get_datetime_string();
-    json_stats["name"]               = name;
-    json_stats["time policy"]        = parameters.time_policy;
-    json_stats["parallelism"]        = parameters.parallelism;
-    json_stats["batch size"]         = parameters.batch_size;
-    json_stats["duration"]           = parameters.duration;
-    json_stats["tuple rate"]         = parameters.tuple_rate;
-    json_stats["sampling rate"]      = parameters.sampling_rate;
-    json_stats["chaining enabled"]   = parameters.use_chaining;
-    json_stats["time unit"]          = std::string {timeunit_string} + 's';
-    json_stats["total measurements"] = total_measurements;
-    json_stats["execution mode"] =
-        get_string_from_execution_mode(parameters.execution_mode);
-    json_stats["time policy"] =
-        get_string_from_time_policy(parameters.time_policy);
-    json_stats["mean"] = value;
+    /*
+     * Return the samples as a histogram.  Each reservoir value stands for
+     * an equal share of all the values seen, so that merging the samples of
+     * replicas that saw different amounts of tuples does not bias the
+     * result.
+     */
+    Histogram<unsigned long> get_samples() const {
+        if (policy.mode != SamplingMode::Reservoir) {
+            return histogram;
+        }
+        Histogram<unsigned long> samples;
+        const std::size_t        size = reservoir.size();
+        for (std::size_t i = 0; i < size; ++i) {
+            samples.record(reservoir[i], (i + 1) * seen_values / size
+                                             - i * seen_values / size);
+        }
+        return samples;
+    }
+};
 
-    return json_stats;
+enum class WarmupMode { None, Time, Tuples, Auto };
+
+/*
+ * How the warm-up phase excluded from all metrics ends: after a number of
+ * seconds, once the sinks received a number of tuples, or once throughput
+ * and latency settle, in which case measurements last for window seconds
+ * (0 meaning until the end of the run).
+ */
+struct WarmupSettings {
+    WarmupMode    mode    = WarmupMode::None;
+    double        seconds = 0.0;
+    unsigned long tuples  = 0;
+    double        window  = 0.0;
+};
+
+/*
+ * Parse a warm-up given as none, time,<seconds>, tuples,<count> or
+ * auto[,<seconds>] on the command line.
+ */
+static inline WarmupSettings get_warmup_from_string(const std::string &s,
+                                                    unsigned duration) {
+    const auto fields = string_split(s, ',');
+    const auto arguments =
+        get_spec_arguments(fields, "get_warmup_from_string");
+    const std::string mode = fields.empty() ? "" : std::string {fields[0]};
+    WarmupSettings    settings;
+
+    if (mode == "none" && arguments.empty()) {
+        settings.mode = WarmupMode::None;
+    } else if (mode == "time" && arguments.size() == 1
+               && arguments[0] < duration) {
+        settings.mode    = WarmupMode::Time;
+        settings.seconds = arguments[0];
+    } else if (mode == "tuples" && arguments.size() == 1
+               && arguments[0] >= 1.0) {
+        settings.mode   = WarmupMode::Tuples;
+        settings.tuples = arguments[0];
+    } else if (mode == "auto" && arguments.size() <= 1
+               && (arguments.empty() || arguments[0] < duration)) {
+        settings.mode   = WarmupMode::Auto;
+        settings.window = arguments.empty() ? 0.0 : arguments[0];
+    } else {
+        std::cerr << "get_warmup_from_string:  error, invalid warm-up "
+                     "(warm-up and measurement times must be shorter than "
+                     "the run)\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return settings;
 }
 
-static inline void serialize_json(const nlohmann::ordered_json &json_stats,
-                                  const std::string &           file_name,
-                                  const std::string &output_directory) {
-    create_directory_if_not_exists(output_directory.c_str());
-    std::ofstream fs {output_directory + "/metric-" + file_name + "-"
-                      + std::to_string(current_time_secs()) + ".json"};
-    fs << json_stats.dump(4) << '\n';
+/*
+ * Span of the run during which metrics are collected.  Sources and sinks
+ * check every tuple against it, which only takes two relaxed loads.  In
+ * time mode the window opens at a fixed time; in tuple and auto mode a
+ * background thread polls the sink counters of the LiveMetricsReporter and
+ * opens it once the warm-up is over.
+ *
+ * Steady state is reached when, over the last steady_intervals polls, the
+ * mean throughput and latency of the older and newer half differ by less
+ * than steady_tolerance: comparing halves rather than single polls ignores
+ * noise and only catches trends, such as windows still filling up.  If that
+ * never happens, measurements start anyway once only the measurement window
+ * (or half the run, without one) is left, and the metric files say so.
+ */
+class MeasurementWindow {
+    static constexpr unsigned long never =
+        std::numeric_limits<unsigned long>::max();
+    static constexpr unsigned steady_intervals = 8;
+    static constexpr double   steady_tolerance = 0.1;
+
+    static constexpr std::chrono::milliseconds poll_interval {250};
+
+    WarmupSettings             settings;
+    std::atomic<unsigned long> start_time {0};
+    std::atomic<unsigned long> end_time {never};
+    std::atomic<unsigned long> excluded_tuples {0};
+    unsigned long              run_start_time       = 0;
+    unsigned long              run_end_time         = 0;
+    bool                       steady_state_reached = false;
+
+    std::thread             detector_thread;
+    std::mutex              stop_mutex;
+    std::condition_variable stop_condition;
+    bool                    stop_requested = false;
+
+    void open(unsigned long now) {
+        if (settings.window > 0.0) {
+            end_time.store(now + settings.window * timeunit_scale_factor,
+                           std::memory_order_relaxed);
+        }
+        start_time.store(now, std::memory_order_relaxed);
+    }
+
+    static bool is_steady(const std::deque<double> &values) {
+        const auto   middle = values.begin() + values.size() / 2;
+        const double older  = std::accumulate(values.begin(), middle, 0.0);
+        const double newer  = std::accumulate(middle, values.end(), 0.0);
+        return older > 0.0 && newer > 0.0
+               && std::abs(newer - older)
+                      <= steady_tolerance * (newer + older) / 2;
+    }
+
+    template<typename LiveMetrics>
+    void detect(LiveMetrics &live_metrics, unsigned long latest_start_time) {
+        std::unique_lock   lock {stop_mutex};
+        auto               previous_totals = live_metrics.get_sink_totals();
+        unsigned long      previous_time   = current_time();
+        std::deque<double> throughputs;
+        std::deque<double> latencies;
+
+        while (!stop_requested) {
+            stop_condition.wait_for(lock, poll_interval);
+            const unsigned long now    = current_time();
+            const auto          totals = live_metrics.get_sink_totals();
+
+            if (settings.mode == WarmupMode::Tuples) {
+                if (totals.received_tuples >= settings.tuples) {
+                    open(now);
+                    return;
+                }
+            } else {
+                const unsigned long samples = totals.sampled_latencies
+                                              - previous_totals
+                                                    .sampled_latencies;
+                throughputs.push_back(
+                    (totals.received_tuples - previous_totals.received_tuples)
+                    / static_cast<double>(difference(now, previous_time)));
+                latencies.push_back(
+                    samples > 0 ? (totals.latency_sum
+                                   - previous_totals.latency_sum)
+                                      / samples
+                                : 0.0);
+                if (throughputs.size() > steady_intervals) {
+                    throughputs.pop_front();
+                    latencies.pop_front();
+                }
+                if (throughputs.size() == steady_intervals
+                    && is_steady(throughputs) && is_steady(latencies)) {
+                    steady_state_reached = true;
+                    open(now);
+                    return;
+                }
+            }
+            if (now >= latest_start_time) {
+                open(now);
+                return;
+            }
+            previous_totals = totals;
+            previous_time   = now;
+        }
+    }
+
+public:
+    ~MeasurementWindow() {
+        stop();
+    }
+
+    /*
+     * Start the run, lasting duration seconds.  Call right before running
+     * the graph.  live_metrics is a LiveMetricsReporter, defined further
+     * down along with the other metric outputs.
+     */
+    template<typename LiveMetrics>
+    void start(const WarmupSettings &warmup, unsigned duration,
+               LiveMetrics &live_metrics) {
+        assert(!detector_thread.joinable());
+        settings       = warmup;
+        run_start_time = current_time();
+
+        unsigned long latest_start_time = never;
+        switch (settings.mode) {
+        case WarmupMode::None:
+            start_time.store(run_start_time, std::memory_order_relaxed);
+            return;
+        case WarmupMode::Time:
+            start_time.store(run_start_time
+                                 + settings.seconds * timeunit_scale_factor,
+                             std::memory_order_relaxed);
+            return;
+        case WarmupMode::Tuples:
+            break;
+        case WarmupMode::Auto:
+            latest_start_time =
+                run_start_time
+                + (settings.window > 0.0 ? duration - settings.window
+                                         : duration / 2.0)
+                      * timeunit_scale_factor;
+            break;
+        }
+        start_time.store(never, std::memory_order_relaxed);
+        live_metrics.enable_counters();
+        detector_thread =
+            std::thread {&MeasurementWindow::detect<LiveMetrics>, this,
+                         std::ref(live_metrics), latest_start_time};
+    }
+
+    /*
+     * End the run.  Call right after the graph is done running.
+     */
+    void stop() {
+        if (detector_thread.joinable()) {
+            {
+                std::lock_guard guard {stop_mutex};
+                stop_requested = true;
+            }
+            stop_condition.notify_one();
+            detector_thread.join();
+        }
+        run_end_time = current_time();
+    }
+
+    bool contains(unsigned long time) const {
+        return time >= start_time.load(std::memory_order_relaxed)
+               && time < end_time.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Same as contains(current_time()), without reading the clock when there
+     * is no warm-up.
+     */
+    bool contains_now() const {
+        return settings.mode == WarmupMode::None || contains(current_time());
+    }
+
+    /*
+     * Account for tuples that sources sent outside the window.
+     */
+    void exclude_tuples(unsigned long amount) {
+        excluded_tuples.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    /*
+     * Return how long the window stayed open, in time units.
+     */
+    unsigned long get_measured_time() const {
+        const unsigned long start =
+            std::max(start_time.load(std::memory_order_relaxed),
+                     run_start_time);
+        const unsigned long end =
+            std::min(end_time.load(std::memory_order_relaxed), run_end_time);
+        return end > start ? end - start : 0;
+    }
+
+    void describe(nlohmann::ordered_json &json_stats) const {
+        const unsigned long warmup_end =
+            std::min(start_time.load(std::memory_order_relaxed), run_end_time);
+        json_stats["warm-up seconds"] =
+            difference(warmup_end, run_start_time)
+            / static_cast<double>(timeunit_scale_factor);
+        json_stats["measured seconds"] =
+            get_measured_time() / static_cast<double>(timeunit_scale_factor);
+        json_stats["excluded tuples"] =
+            excluded_tuples.load(std::memory_order_relaxed);
+        if (settings.mode == WarmupMode::Auto) {
+            json_stats["steady state reached"] = steady_state_reached;
+        }
+    }
+};
+
+static MeasurementWindow global_measurement_window;
+
+enum class LoadShape { Constant, Step, Ramp, Sinusoid, Bursty };
+
+/*
+ * Offered load of a source replica, in tuples per second, as a function of
+ * the seconds elapsed since it started.  The base rate is the one given with
+ * --rate, the other fields are only used by the shapes that need them:
+ *
+ *   step:     base_rate until change_time, then second_rate
+ *   ramp:     linear from base_rate to second_rate over change_time seconds
+ *   sinusoid: base_rate + amplitude * sin(2 * pi * t / period)
+ *   bursty:   second_rate for the first change_time seconds of every period,
+ *             base_rate for the rest of it
+ */
+struct LoadProfile {
+    LoadShape shape       = LoadShape::Constant;
+    double    base_rate   = 0.0;
+    double    second_rate = 0.0;
+    double    change_time = 0.0;
+    double    amplitude   = 0.0;
+    double    period      = 0.0;
+
+    double rate_at(double t) const {
+        switch (shape) {
+        case LoadShape::Constant:
+            return base_rate;
+        case LoadShape::Step:
+            return t < change_time ? base_rate : second_rate;
+        case LoadShape::Ramp:
+            return t < change_time ? base_rate
+                                         + (second_rate - base_rate)
+                                               * (t / change_time)
+                                   : second_rate;
+        case LoadShape::Sinusoid:
+            return base_rate + amplitude * std::sin(2 * M_PI * t / period);
+        case LoadShape::Bursty:
+            return std::fmod(t, period) < change_time ? second_rate
+                                                      : base_rate;
+        }
+        return base_rate;
+    }
+
+    /*
+     * Return how many tuples should have been sent in the first t seconds,
+     * i.e. the integral of rate_at() between 0 and t.
+     */
+    double expected_tuples(double t) const {
+        switch (shape) {
+        case LoadShape::Constant:
+            return base_rate * t;
+        case LoadShape::Step:
+            return t < change_time ? base_rate * t
+                                   : base_rate * change_time
+                                         + second_rate * (t - change_time);
+        case LoadShape::Ramp:
+            return t < change_time
+                       ? base_rate * t
+                             + (second_rate - base_rate) * t * t
+                                   / (2 * change_time)
+                       : (base_rate + second_rate) * change_time / 2
+                             + second_rate * (t - change_time);
+        case LoadShape::Sinusoid:
+            return base_rate * t
+                   + amplitude * period / (2 * M_PI)
+                         * (1 - std::cos(2 * M_PI * t / period));
+        case LoadShape::Bursty: {
+            const double periods   = std::floor(t / period);
+            const double remainder = t - periods * period;
+            const double per_period =
+                second_rate * change_time + base_rate * (period - change_time);
+            return periods * per_period
+                   + (remainder < change_time
+                          ? second_rate * remainder
+                          : second_rate * change_time
+                                + base_rate * (remainder - change_time));
+        }
+        }
+        return base_rate * t;
+    }
+};
+
+/*
+ * Parse a load profile given as "shape[,argument...]" on the command line.
+ * Rates are in tuples per second and times in seconds:
+ *
+ *   constant
+ *   step,<rate>,<seconds>
+ *   ramp,<rate>[,<seconds>]         (defaults to the whole run)
+ *   sinusoid,<amplitude>,<period>
+ *   bursty,<rate>,<seconds>,<period>
+ */
+static inline LoadProfile get_load_profile_from_string(const std::string &s,
+                                                       unsigned base_rate,
+                                                       unsigned duration) {
+    const auto  fields = string_split(s, ',');
+    auto        arguments =
+        get_spec_arguments(fields, "get_load_profile_from_string");
+    LoadProfile profile;
+    profile.base_rate = base_rate;
+
+    const std::string shape = fields.empty() ? "" : std::string {fields[0]};
+    std::size_t       expected_arguments = 0;
+    if (shape == "constant") {
+        profile.shape = LoadShape::Constant;
+    } else if (shape == "step") {
+        profile.shape = LoadShape::Step;
+        expected_arguments = 2;
+    } else if (shape == "ramp") {
+        profile.shape = LoadShape::Ramp;
+        if (arguments.size() == 1) {
+            arguments.push_back(duration);
+        }
+        expected_arguments = 2;
+    } else if (shape == "sinusoid") {
+        profile.shape = LoadShape::Sinusoid;
+        expected_arguments = 2;
+    } else if (shape == "bursty") {
+        profile.shape = LoadShape::Bursty;
+        expected_arguments = 3;
+    } else {
+        std::cerr << "get_load_profile_from_string:  error, invalid shape\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (arguments.size() != expected_arguments) {
+        std::cerr << "get_load_profile_from_string:  error, " << shape
+                  << " takes " << expected_arguments << " arguments\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    switch (profile.shape) {
+    case LoadShape::Constant:
+        break;
+    case LoadShape::Step:
+    case LoadShape::Ramp:
+        profile.second_rate = arguments[0];
+        profile.change_time = arguments[1];
+        break;
+    case LoadShape::Sinusoid:
+        profile.amplitude = arguments[0];
+        profile.period    = arguments[1];
+        break;
+    case LoadShape::Bursty:
+        profile.second_rate = arguments[0];
+        profile.change_time = arguments[1];
+        profile.period      = arguments[2];
+        break;
+    }
+
+    if ((profile.shape == LoadShape::Ramp && profile.change_time <= 0.0)
+        || ((profile.shape == LoadShape::Sinusoid
+             || profile.shape == LoadShape::Bursty)
+            && profile.period <= 0.0)) {
+        std::cerr << "get_load_profile_from_string:  error, " << shape
+                  << " needs a positive time span\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (profile.shape == LoadShape::Sinusoid
+        && profile.amplitude > profile.base_rate) {
+        std::cerr << "get_load_profile_from_string:  error, the amplitude "
+                     "must not exceed the base rate\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return profile;
+}
+
+/*
+ * Token-bucket pacing for rate-limited sources.  Tokens accrue following the
+ * load profile; the clock is only read when the bucket is empty, and every
+ * read releases all tokens accrued since the previous one, so that sources
+ * send small batches back to back instead of spinning after every tuple.
+ * While waiting for the next token the source sleeps if it is far away,
+ * waking up early enough to absorb the usual oversleeping, yields if it is
+ * close, and only spins for the last few microseconds.
+ *
+ * A closed-loop bucket holds at most one millisecond worth of tokens: a
+ * source that falls behind drops the ones it missed and stamps tuples with
+ * the time they leave.  An open-loop bucket has no limit: the i-th tuple is
+ * due when the profile says that i tuples should have been sent, and it is
+ * stamped with that due time no matter how late it actually leaves, which
+ * keeps stalls on full queues inside the measured latency.  The lag between
+ * the two tells how far the source fell behind.
+ */
+class RateController {
+    static constexpr double spin_threshold  = 20e-6;
+    static constexpr double sleep_threshold = 200e-6;
+
+    LoadProfile              profile;
+    bool                     open_loop;
+    unsigned long            start_time;
+    unsigned long            next_tuple      = 0;
+    unsigned long            released_tuples = 0;
+    double                   dropped_tuples  = 0.0;
+    unsigned long            release_time    = 0;
+    double                   release_expected_tuples = 0.0;
+    double                   release_rate            = 0.0;
+    Histogram<unsigned long> lag_samples;
+
+    double seconds_since_start(unsigned long time) const {
+        return static_cast<double>(time - start_time) / timeunit_scale_factor;
+    }
+
+    void release_tokens(SourceDeadline &deadline) {
+        for (;;) {
+            const unsigned long now      = current_time();
+            const double        elapsed  = seconds_since_start(now);
+            const double        rate     = profile.rate_at(elapsed);
+            double              expected = profile.expected_tuples(elapsed);
+
+            if (!open_loop) {
+                const double burst = std::max(1.0, rate / 1000);
+                if (expected - dropped_tuples - released_tuples > burst) {
+                    dropped_tuples = expected - released_tuples - burst;
+                }
+                expected -= dropped_tuples;
+            }
+            if (expected >= released_tuples) {
+                released_tuples         = std::floor(expected) + 1;
+                release_time            = now;
+                release_expected_tuples = expected;
+                release_rate            = rate;
+                return;
+            }
+            if (now >= deadline.get_end_time()) {
+                deadline.check_on_next_call();
+                released_tuples = next_tuple + 1;
+                release_time    = now;
+                release_rate    = 0.0;
+                return;
+            }
+
+            const double until_end =
+                static_cast<double>(deadline.get_end_time() - now)
+                / timeunit_scale_factor;
+            const double wait_time =
+                std::min(until_end, rate > 0.0
+                                        ? (released_tuples - expected) / rate
+                                        : sleep_threshold);
+            if (wait_time >= sleep_threshold) {
+                std::this_thread::sleep_for(std::chrono::duration<double> {
+                    wait_time - sleep_threshold / 2});
+            } else if (wait_time >= spin_threshold) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /*
+     * Time at which the given tuple was due, assuming that the rate stayed
+     * the same since it was.  This is exact for a constant profile and a
+     * close approximation for the others, whose rate changes over seconds
+     * rather than over single tuples.
+     */
+    unsigned long due_time(unsigned long tuple) const {
+        if (release_rate <= 0.0) {
+            return release_time;
+        }
+        const unsigned long late_by = (release_expected_tuples - tuple)
+                                      / release_rate * timeunit_scale_factor;
+        return std::max(start_time, release_time - std::min(release_time,
+                                                             late_by));
+    }
+
+public:
+    RateController(const LoadProfile &profile, bool open_loop)
+        : profile {profile}, open_loop {open_loop},
+          start_time {current_time()} {
+        assert(profile.base_rate > 0.0);
+    }
+
+    /*
+     * Wait until the next tuple may be sent and return its timestamp: the
+     * time it is due in open-loop mode, the current time otherwise.  Once
+     * the deadline has passed, return right away and make the next check of
+     * the deadline read the clock, so that the source stops even if the
+     * profile asks for no more tuples.
+     */
+    unsigned long wait_for_next_tuple(SourceDeadline &deadline) {
+        if (next_tuple >= released_tuples) {
+            release_tokens(deadline);
+        }
+        const unsigned long tuple = next_tuple++;
+        if (!open_loop) {
+            return current_time();
+        }
+        const unsigned long due = due_time(tuple);
+        if (global_measurement_window.contains(due)) {
+            lag_samples.record(release_time - due);
+        }
+        return due;
+    }
+
+    const Histogram<unsigned long> &get_lag_samples() const {
+        return lag_samples;
+    }
+};
+
+/*
+ * Parse an affinity string, holding one core list per operator separated by
+ * commas, in the same order as the parallelism degrees.  A core list joins
+ * single cores and inclusive ranges with '+', as in 0-3+8; "*" leaves the
+ * operator's replicas unpinned.
+ */
+static inline std::vector<std::vector<unsigned>>
+get_affinity_from_string(const char *s) {
+    const long available_cores = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<std::vector<unsigned>> core_lists;
+
+    for (const auto &list : string_split(s, ',')) {
+        auto &cores = core_lists.emplace_back();
+        if (list == "*") {
+            continue;
+        }
+        for (const auto &range : string_split(list, '+')) {
+            const std::string   field {range};
+            char *              end   = nullptr;
+            const unsigned long first = std::strtoul(field.c_str(), &end, 10);
+            unsigned long       last  = first;
+            if (*end == '-') {
+                last = std::strtoul(end + 1, &end, 10);
+            }
+            if (field.empty() || field.back() == '-' || *end != '\0'
+                || last < first
+                || last >= static_cast<unsigned long>(available_cores)) {
+                std::cerr << "get_affinity_from_string:  error, invalid "
+                             "core range "
+                          << field << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+            for (unsigned long core = first; core <= last; ++core) {
+                cores.push_back(core);
+            }
+        }
+    }
+    return core_lists;
+}
+
+/*
+ * Inverse of get_affinity_from_string() for a single core list.
+ */
+static inline std::string
+get_string_from_core_list(const std::vector<unsigned> &cores) {
+    if (cores.empty()) {
+        return "*";
+    }
+    std::string list;
+    for (const auto core : cores) {
+        list += (list.empty() ? "" : "+") + std::to_string(core);
+    }
+    return list;
+}
+
+/*
+ * Return the NUMA node a core belongs to, as listed in sysfs, or -1 when it
+ * cannot be told.
+ */
+static inline int get_numa_node_of_core(unsigned core) {
+    const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(core);
+
+    DIR *directory = opendir(path.c_str());
+    int  node      = -1;
+    if (!directory) {
+        return node;
+    }
+    while (const auto *entry = readdir(directory)) {
+        const std::string_view name {entry->d_name};
+        if (name.size() > 4 && name.substr(0, 4) == "node") {
+            node = std::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(directory);
+    return node;
+}
+
+/*
+ * Thread placement chosen through --affinity.  Core lists are assigned to
+ * operators by name before the graph runs; each replica then pins its own
+ * thread on its first call, taking the cores of its operator in round-robin
+ * order by replica index.  A thread is only pinned once, so chained
+ * operators run on the cores of the first operator in the chain.
+ */
+class ThreadPlacement {
+    struct Pinning {
+        std::string operator_name;
+        std::size_t replica_index;
+        unsigned    core;
+        int         numa_node;
+    };
+
+    std::vector<std::pair<std::string, std::vector<unsigned>>> assignments;
+    std::vector<Pinning>                                        pinnings;
+    std::mutex                                                  pinning_mutex;
+
+    auto find_assignment(const std::string &operator_name) const {
+        return std::find_if(assignments.begin(), assignments.end(),
+                            [&operator_name](const auto &assignment) {
+                                return assignment.first == operator_name;
+                            });
+    }
+
+public:
+    void assign(const std::string &           operator_name,
+                const std::vector<unsigned> &cores) {
+        if (!cores.empty()) {
+            assignments.emplace_back(operator_name, cores);
+        }
+    }
+
+    /*
+     * Pin the calling thread to the core assigned to the given replica.
+     * Return whether the thread was pinned by this call.
+     */
+    bool pin_current_thread(const std::string &operator_name,
+                            std::size_t        replica_index) {
+        static thread_local bool is_pinned  = false;
+        const auto               assignment = find_assignment(operator_name);
+        if (is_pinned || assignment == assignments.end()) {
+            return false;
+        }
+        const auto &cores = assignment->second;
+        const auto  core  = cores[replica_index % cores.size()];
+#if defined(__linux__)
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(core, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof cpu_set, &cpu_set)
+            != 0) {
+            std::cerr << "Error: could not pin replica " << replica_index
+                      << " of " << operator_name << " to core " << core
+                      << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+#endif
+        is_pinned = true;
+        std::lock_guard guard {pinning_mutex};
+        pinnings.push_back({operator_name, replica_index, core,
+                            get_numa_node_of_core(core)});
+        return true;
+    }
+
+    void describe(nlohmann::ordered_json &json_stats) {
+        std::lock_guard guard {pinning_mutex};
+        std::sort(pinnings.begin(), pinnings.end(),
+                  [this](const Pinning &a, const Pinning &b) {
+                      const auto a_position = find_assignment(a.operator_name);
+                      const auto b_position = find_assignment(b.operator_name);
+                      return a_position != b_position
+                                 ? a_position < b_position
+                                 : a.replica_index < b.replica_index;
+                  });
+        auto affinity = nlohmann::ordered_json::array();
+        for (const auto &pinning : pinnings) {
+            nlohmann::ordered_json entry;
+            entry["operator"]  = pinning.operator_name;
+            entry["replica"]   = pinning.replica_index;
+            entry["core"]      = pinning.core;
+            entry["NUMA node"] = pinning.numa_node;
+            affinity.push_back(entry);
+        }
+        json_stats["affinity"] = affinity;
+    }
+};
+
+static ThreadPlacement global_thread_placement;
+
+/*
+ * Replace the contents of container with a copy made by the calling thread.
+ * Under the kernel's default first-touch policy, the copy ends up on the NUMA
+ * node the thread runs on, rather than on the one that loaded the dataset.
+ */
+template<typename Container>
+static inline void copy_to_local_numa_node(Container &container) {
+    Container local_copy {container};
+    container.swap(local_copy);
+}
+
+/*
+ * A private, writable memory mapping of a whole file.  Writes are copy on
+ * write and never reach the file, so texts can be unescaped in place.  A file
+ * that cannot be opened maps as empty.
+ */
+class MappedFile {
+    char *      mapping      = nullptr;
+    std::size_t mapping_size = 0;
+
+public:
+    MappedFile(const char *path) {
+        const int descriptor = open(path, O_RDONLY);
+        if (descriptor < 0) {
+            return;
+        }
+        struct stat file_stats;
+        if (fstat(descriptor, &file_stats) == 0 && file_stats.st_size > 0) {
+            mapping_size = static_cast<std::size_t>(file_stats.st_size);
+            void *address = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE, descriptor, 0);
+            if (address == MAP_FAILED) {
+                std::cerr << "Error: could not map " << path << '\n';
+                std::exit(EXIT_FAILURE);
+            }
+            mapping = static_cast<char *>(address);
+        }
+        close(descriptor);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (mapping) {
+            munmap(mapping, mapping_size);
+        }
+    }
+
+    char *begin() const {
+        return mapping;
+    }
+
+    char *end() const {
+        return mapping + mapping_size;
+    }
+
+    std::size_t size() const {
+        return mapping_size;
+    }
+};
+
+/*
+ * Split [begin, end) into count slices with every bound moved forward to the
+ * start of a line, so that every line belongs to exactly one slice, and
+ * return the count + 1 bounds.  The bounds must be found before anything is
+ * unescaped, since unescaped texts may hold newlines.
+ */
+static inline std::vector<char *>
+get_line_aligned_slices(char *begin, char *end, std::size_t count) {
+    std::vector<char *> bounds {begin};
+    const std::size_t   size = end - begin;
+    for (std::size_t i = 1; i <= count; ++i) {
+        char *bound = begin + size * i / count;
+        if (bound < bounds.back()) {
+            bound = bounds.back();
+        } else if (bound > begin && bound < end) {
+            const auto newline = static_cast<char *>(
+                std::memchr(bound - 1, '\n', end - bound + 1));
+            bound              = newline ? newline + 1 : end;
+        }
+        bounds.push_back(bound);
+    }
+    return bounds;
+}
+
+/*
+ * Return a pointer to the closing quote of the JSON string whose contents
+ * start at begin, or nullptr if there is none before end.
+ */
+static inline char *find_json_string_end(char *begin, char *end) {
+    for (char *position = begin; position < end; ++position) {
+        position =
+            static_cast<char *>(std::memchr(position, '"', end - position));
+        if (!position) {
+            return nullptr;
+        }
+        char *backslash = position;
+        while (backslash > begin && backslash[-1] == '\\') {
+            --backslash;
+        }
+        if ((position - backslash) % 2 == 0) {
+            return position;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Decode the four hexadecimal digits at position, or return nullopt if they
+ * are not all hexadecimal digits.
+ */
+static inline std::optional<unsigned> decode_hex_quad(const char *position) {
+    unsigned value = 0;
+    for (int i = 0; i < 4; ++i) {
+        const char c = position[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return {};
+        }
+    }
+    return value;
+}
+
+/*
+ * Write code_point as UTF-8 at output and return the position past it.
+ */
+static inline char *encode_utf8(unsigned code_point, char *output) {
+    if (code_point < 0x80) {
+        *output++ = static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        *output++ = static_cast<char>(0xc0 | code_point >> 6);
+        *output++ = static_cast<char>(0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        *output++ = static_cast<char>(0xe0 | code_point >> 12);
+        *output++ = static_cast<char>(0x80 | (code_point >> 6 & 0x3f));
+        *output++ = static_cast<char>(0x80 | (code_point & 0x3f));
+    } else {
+        *output++ = static_cast<char>(0xf0 | code_point >> 18);
+        *output++ = static_cast<char>(0x80 | (code_point >> 12 & 0x3f));
+        *output++ = static_cast<char>(0x80 | (code_point >> 6 & 0x3f));
+        *output++ = static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+    return output;
+}
+
+/*
+ * Unescape the JSON string whose contents start at begin and end at the
+ * quote at end, in place, since no escape sequence is shorter than what it
+ * stands for.  Strings without escape sequences are left untouched, so the
+ * pages holding them are never copied.  Return nullopt if the string holds an
+ * invalid escape sequence.
+ */
+static inline std::optional<std::string_view>
+unescape_json_string_in_place(char *begin, char *end) {
+    char *input =
+        static_cast<char *>(std::memchr(begin, '\\', end - begin));
+    if (!input) {
+        return std::string_view {begin, static_cast<std::size_t>(end - begin)};
+    }
+    char *output = input;
+    while (input < end) {
+        if (*input != '\\') {
+            *output++ = *input++;
+            continue;
+        }
+        if (end - input < 2) {
+            return {};
+        }
+        const char escaped = input[1];
+        input += 2;
+        switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+            *output++ = escaped;
+            break;
+        case 'b':
+            *output++ = '\b';
+            break;
+        case 'f':
+            *output++ = '\f';
+            break;
+        case 'n':
+            *output++ = '\n';
+            break;
+        case 'r':
+            *output++ = '\r';
+            break;
+        case 't':
+            *output++ = '\t';
+            break;
+        case 'u': {
+            const auto unit = end - input >= 4 ? decode_hex_quad(input)
+                                               : std::nullopt;
+            if (!unit || (*unit >= 0xdc00 && *unit < 0xe000)) {
+                return {};
+            }
+            input += 4;
+            unsigned code_point = *unit;
+            if (code_point >= 0xd800 && code_point < 0xdc00) {
+                const auto low = end - input >= 6 && input[0] == '\\'
+                                         && input[1] == 'u'
+                                     ? decode_hex_quad(input + 2)
+                                     : std::nullopt;
+                if (!low || *low < 0xdc00 || *low >= 0xe000) {
+                    return {};
+                }
+                input += 6;
+                code_point =
+                    0x10000 + ((code_point - 0xd800) << 10) + (*low - 0xdc00);
+            }
+            output = encode_utf8(code_point, output);
+            break;
+        }
+        default:
+            return {};
+        }
+    }
+    return std::string_view {begin, static_cast<std::size_t>(output - begin)};
+}
+
+/*
+ * The text of a tweet and the ID of its author, which is empty if unknown.
+ */
+struct TweetRecord {
+    std::string_view text;
+    std::string_view author_id;
+};
+
+/*
+ * Return the unescaped "text" and "author_id" members of the "data" object of
+ * the JSON tweet in [begin, end), in the same format as the Twitter API's
+ * filtered stream.  Rather than building a document, jump from one structural
+ * character to the next, skipping strings whole, and only unescape the
+ * strings needed.  Return nullopt if there is no text or the line is
+ * malformed.
+ */
+static inline std::optional<TweetRecord> get_tweet_in_place(char *begin,
+                                                             char *end) {
+    const auto skip_whitespace = [end](char *position) {
+        while (position < end
+               && (*position == ' ' || *position == '\t'
+                   || *position == '\r')) {
+            ++position;
+        }
+        return position;
+    };
+    std::optional<std::string_view> text;
+    std::optional<std::string_view> author_id;
+    std::string_view                top_level_key;
+    bool                            is_in_data = false;
+    int                             depth      = 0;
+
+    for (char *position = begin; position < end && !(text && author_id);
+         ++position) {
+        switch (*position) {
+        case '{':
+        case '[':
+            if (depth == 1) {
+                is_in_data = *position == '{' && top_level_key == "data";
+            }
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            --depth;
+            break;
+        case '"': {
+            char *string_end = find_json_string_end(position + 1, end);
+            if (!string_end) {
+                return {};
+            }
+            const std::string_view string {
+                position + 1,
+                static_cast<std::size_t>(string_end - position - 1)};
+            char *next = skip_whitespace(string_end + 1);
+            if (next == end || *next != ':') {
+                position = string_end;
+                break;
+            }
+            position = next;
+            if (depth == 1) {
+                top_level_key = string;
+            } else if (depth == 2 && is_in_data
+                       && (string == "text" || string == "author_id")) {
+                char *value = skip_whitespace(next + 1);
+                char *value_end =
+                    value < end && *value == '"'
+                        ? find_json_string_end(value + 1, end)
+                        : nullptr;
+                if (!value_end) {
+                    return {};
+                }
+                (string == "text" ? text : author_id) =
+                    unescape_json_string_in_place(value + 1, value_end);
+                position = value_end;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    if (!text) {
+        return {};
+    }
+    return TweetRecord {*text, author_id.value_or(std::string_view {})};
+}
+
+/*
+ * Return the first tweet at or after position, moving position past its line,
+ * or nullopt if there is none before end.  Blank lines are skipped, while a
+ * line that holds no tweet text is a fatal error.
+ */
+static inline std::optional<TweetRecord>
+read_next_tweet(char *&position, char *end, const MappedFile &file,
+                const char *path) {
+    while (position < end) {
+        char *line = position;
+        auto  line_end =
+            static_cast<char *>(std::memchr(line, '\n', end - line));
+        line_end = line_end ? line_end : end;
+        position = line_end == end ? end : line_end + 1;
+        if (std::all_of(line, line_end,
+                        [](unsigned char c) { return std::isspace(c); })) {
+            continue;
+        }
+        const auto tweet = get_tweet_in_place(line, line_end);
+        if (!tweet) {
+            std::cerr << "Error: no tweet text in the line at byte "
+                      << line - file.begin() << " of " << path << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+        return tweet;
+    }
+    return {};
+}
+
+/*
+ * An immutable collection of the tweets in a JSON Lines file, viewed in place
+ * in a private mapping of the file.  Source replicas share one
+ * corpus and emit views into it rather than copies, so it must outlive every
+ * tuple referring to it.  Unless streaming, the whole file is indexed up
+ * front, one line-aligned slice per hardware thread.  When streaming, the file
+ * is only split into one slice per source replica, and each slice is read by
+ * its replica's TweetReplayer.
+ */
+class TweetCorpus {
+    static constexpr std::size_t min_bytes_per_thread = 1 << 20;
+
+    std::string                   path;
+    MappedFile                    file;
+    std::vector<TweetRecord>      tweets;
+    std::vector<char *>           stream_slices;
+
+    friend class TweetReplayer;
+
+public:
+    TweetCorpus(const char *path, bool streaming = false,
+                std::size_t replica_count = 1)
+        : path {path}, file {path} {
+        if (streaming) {
+            stream_slices = get_line_aligned_slices(file.begin(), file.end(),
+                                                    replica_count);
+            return;
+        }
+        const std::size_t thread_count = std::clamp<std::size_t>(
+            file.size() / min_bytes_per_thread, 1,
+            std::max(std::thread::hardware_concurrency(), 1u));
+        const auto slices =
+            get_line_aligned_slices(file.begin(), file.end(), thread_count);
+        std::vector<std::vector<TweetRecord>> slice_tweets(thread_count);
+        std::vector<std::thread>              threads;
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([this, i, &slices, &slice_tweets] {
+                char *position = slices[i];
+                while (const auto tweet = read_next_tweet(
+                           position, slices[i + 1], file,
+                           this->path.c_str())) {
+                    slice_tweets[i].push_back(*tweet);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (const auto &slice : slice_tweets) {
+            tweets.insert(tweets.end(), slice.begin(), slice.end());
+        }
+    }
+
+    TweetCorpus(const TweetCorpus &) = delete;
+    TweetCorpus &operator=(const TweetCorpus &) = delete;
+
+    bool is_streaming() const {
+        return !stream_slices.empty();
+    }
+
+    /*
+     * Only tells whether the file is empty when streaming.
+     */
+    bool empty() const {
+        return is_streaming() ? file.size() == 0 : tweets.empty();
+    }
+
+    std::size_t size() const {
+        return tweets.size();
+    }
+
+    const TweetRecord &operator[](std::size_t index) const {
+        return tweets[index];
+    }
+
+    auto begin() const {
+        return tweets.begin();
+    }
+
+    auto end() const {
+        return tweets.end();
+    }
+};
+
+/*
+ * Hands a source replica the tweets of a corpus in order, starting over once
+ * past the last one.  When the corpus is streaming, each replica replays its
+ * own slice of the file, reading it from the mapping on the first pass and
+ * keeping views of the tweets found for the following ones, so that every
+ * tweet is unescaped exactly once, by the replica that owns it.
+ */
+class TweetReplayer {
+    const TweetCorpus &      corpus;
+    std::vector<TweetRecord> streamed_tweets;
+    char *                   position = nullptr;
+    char *                   end      = nullptr;
+    std::size_t              index    = 0;
+
+public:
+    TweetReplayer(const TweetCorpus &corpus, std::size_t replica_index)
+        : corpus {corpus} {
+        if (corpus.is_streaming()) {
+            assert(replica_index + 1 < corpus.stream_slices.size());
+            position = corpus.stream_slices[replica_index];
+            end      = corpus.stream_slices[replica_index + 1];
+        }
+    }
+
+    TweetRecord next() {
+        if (!corpus.is_streaming()) {
+            const auto tweet = corpus[index];
+            index            = (index + 1) % corpus.size();
+            return tweet;
+        }
+        if (position < end) {
+            if (const auto tweet = read_next_tweet(
+                    position, end, corpus.file, corpus.path.c_str())) {
+                streamed_tweets.push_back(*tweet);
+                return *tweet;
+            }
+        }
+        if (streamed_tweets.empty()) {
+            std::cerr << "Error: no tweets in a source replica's share of "
+                      << corpus.path << ".  Use fewer source replicas\n";
+            std::exit(EXIT_FAILURE);
+        }
+        const auto tweet = streamed_tweets[index];
+        index            = (index + 1) % streamed_tweets.size();
+        return tweet;
+    }
+};
+
+static inline void create_directory_if_not_exists(const char *path) noexcept {
+    const auto dir = opendir(path);
+    if (dir) {
+        const int status = closedir(dir);
+        if (status != 0) {
+            std::cerr << "Error closing directory " << path << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+    } else {
+        const int status = mkdir(path, S_IRWXU | S_IRGRP | S_IROTH);
+        if (status != 0) {
+            std::cerr << "Error creating directory\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+template<typename Parameters>
+static inline nlohmann::ordered_json
+get_distribution_stats(const Metric<unsigned long> &metric,
+                       const Parameters &           parameters,
+                       unsigned long                total_measurements) {
+    nlohmann::ordered_json json_stats;
+    json_stats["date"]                 = get_datetime_string();
+    json_stats["name"]                 = metric.name();
+    json_stats["time policy"]          = parameters.time_policy;
+    json_stats["parallelism"]          = parameters.parallelism;
+    json_stats["batch size"]           = parameters.batch_size;
+    json_stats["duration"]             = parameters.duration;
+    json_stats["tuple rate"]           = parameters.tuple_rate;
+    json_stats["sampling rate"]        = parameters.sampling_rate;
+    json_stats["sampling policy"]      = parameters.sampling_policy;
+    json_stats["chaining enabled"]     = parameters.use_chaining;
+    json_stats["open loop"]            = parameters.use_open_loop;
+    json_stats["load profile"]         = parameters.load_profile;
+    json_stats["warm-up"]              = parameters.warmup;
+    json_stats["time unit"]            = std::string {timeunit_string} + 's';
+    json_stats["sampled measurements"] = metric.size();
+    json_stats["total measurements"]   = total_measurements;
+
+    json_stats["execution mode"] =
+        get_string_from_execution_mode(parameters.execution_mode);
+    json_stats["time policy"] =
+        get_string_from_time_policy(parameters.time_policy);
+    global_measurement_window.describe(json_stats);
+    global_thread_placement.describe(json_stats);
+
+    if (!metric.empty()) {
+        json_stats["mean"] = metric.mean();
+
+        for (const auto percentile : {0.0, 0.05, 0.25, 0.5, 0.75, 0.95, 1.0}) {
+            const auto label =
+                std::to_string(static_cast<int>(percentile * 100))
+                + "th percentile";
+            json_stats[label] = metric.percentile(percentile);
+        }
+    } else {
+        json_stats["mean"] = 0;
+        for (const auto percentile : {"0", "25", "50", "75", "95", "100"}) {
+            const auto label  = std::string {percentile} + "th percentile";
+            json_stats[label] = 0;
+        }
+    }
+
+    return json_stats;
+}
+
+template<typename T, typename Parameters>
+static inline nlohmann::ordered_json
+get_single_value_stats(T value, const std::string &name,
+                       const Parameters &parameters,
+                       unsigned long     total_measurements) {
+    nlohmann::ordered_json json_stats;
+    json_stats["date"]               = get_datetime_string();
+    json_stats["name"]               = name;
+    json_stats["time policy"]        = parameters.time_policy;
+    json_stats["parallelism"]        = parameters.parallelism;
+    json_stats["batch size"]         = parameters.batch_size;
+    json_stats["duration"]           = parameters.duration;
+    json_stats["tuple rate"]         = parameters.tuple_rate;
+    json_stats["sampling rate"]      = parameters.sampling_rate;
+    json_stats["sampling policy"]    = parameters.sampling_policy;
+    json_stats["chaining enabled"]   = parameters.use_chaining;
+    json_stats["open loop"]          = parameters.use_open_loop;
+    json_stats["load profile"]       = parameters.load_profile;
+    json_stats["warm-up"]            = parameters.warmup;
+    json_stats["time unit"]          = std::string {timeunit_string} + 's';
+    json_stats["total measurements"] = total_measurements;
+    json_stats["execution mode"] =
+        get_string_from_execution_mode(parameters.execution_mode);
+    json_stats["time policy"] =
+        get_string_from_time_policy(parameters.time_policy);
+    global_measurement_window.describe(json_stats);
+    global_thread_placement.describe(json_stats);
+    json_stats["mean"] = value;
+
+    return json_stats;
+}
+
+static inline void serialize_json(const nlohmann::ordered_json &json_stats,
+                                  const std::string &           file_name,
+                                  const std::string &output_directory) {
+    create_directory_if_not_exists(output_directory.c_str());
+    std::ofstream fs {output_directory + "/metric-" + file_name + "-"
+                      + std::to_string(current_time_secs()) + ".json"};
+    fs << json_stats.dump(4) << '\n';
+}
+
+/*
+ * Counters owned by a single operator replica.  Only the owning replica
+ * updates them, so relaxed loads and stores are enough on the hot path and
+ * the LiveMetricsReporter thread can read them at any time without locking.
+ */
+class alignas(64) ReplicaCounters {
+    using LatencyHistogram = Histogram<unsigned long>;
+
+    std::atomic<unsigned long>              tuples {0};
+    std::vector<std::atomic<unsigned long>> latency_counts;
+
+    static void increment(std::atomic<unsigned long> &counter,
+                          unsigned long               amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    }
+
+public:
+    ReplicaCounters(bool with_latencies)
+        : latency_counts(with_latencies ? LatencyHistogram::bucket_count
+                                        : 0) {}
+
+    void add_tuples(unsigned long amount = 1) {
+        increment(tuples, amount);
+    }
+
+    void record_latency(unsigned long latency) {
+        assert(!latency_counts.empty());
+        increment(latency_counts[LatencyHistogram::bucket_index(latency)], 1);
+    }
+
+    unsigned long get_tuples() const {
+        return tuples.load(std::memory_order_relaxed);
+    }
+
+    unsigned long get_latency_count(std::size_t bucket) const {
+        return latency_counts[bucket].load(std::memory_order_relaxed);
+    }
+};
+
+/*
+ * What an operator replica updates its live counters through.  It holds no
+ * counters when nothing reads them, in which case updates cost one branch.
+ */
+class ReplicaCountersHandle {
+    ReplicaCounters *counters = nullptr;
+
+public:
+    ReplicaCountersHandle(ReplicaCounters *counters = nullptr)
+        : counters {counters} {}
+
+    void add_tuples(unsigned long amount = 1) {
+        if (counters) {
+            counters->add_tuples(amount);
+        }
+    }
+
+    void record_latency(unsigned long latency) {
+        if (counters) {
+            counters->record_latency(latency);
+        }
+    }
+};
+
+/*
+ * Background thread that periodically reads the counters of every source
+ * and sink replica and appends a JSON line with the throughput and latency
+ * percentiles observed during the last interval.  Replicas only get
+ * counters once enable_counters() was called, which start() does.
+ */
+class LiveMetricsReporter {
+    std::deque<ReplicaCounters> source_counters;
+    std::deque<ReplicaCounters> sink_counters;
+    std::mutex                  registration_mutex;
+    bool                        counters_enabled = false;
+
+    std::thread             reporter_thread;
+    std::mutex              stop_mutex;
+    std::condition_variable stop_condition;
+    bool                    stop_requested = false;
+
+    std::vector<unsigned long> previous_sent_tuples;
+    std::vector<unsigned long> previous_received_tuples;
+    std::vector<unsigned long> previous_latency_counts;
+
+    /*
+     * Return the amount by which each counter grew since the previous call,
+     * updating the previous values accordingly.  Replicas registered after
+     * the previous call start from zero.
+     */
+    template<typename Read>
+    static unsigned long
+    collect_deltas(const std::deque<ReplicaCounters> &counters,
+                   std::vector<unsigned long> &previous_values, Read read) {
+        unsigned long total = 0;
+        previous_values.resize(counters.size(), 0);
+        for (std::size_t i = 0; i < counters.size(); ++i) {
+            const unsigned long value = read(counters[i]);
+            total += value - previous_values[i];
+            previous_values[i] = value;
+        }
+        return total;
+    }
+
+    nlohmann::ordered_json collect_interval(double elapsed_seconds,
+                                            double interval_seconds) {
+        std::lock_guard guard {registration_mutex};
+
+        const unsigned long sent_tuples =
+            collect_deltas(source_counters, previous_sent_tuples,
+                           [](const auto &c) { return c.get_tuples(); });
+        const unsigned long received_tuples =
+            collect_deltas(sink_counters, previous_received_tuples,
+                           [](const auto &c) { return c.get_tuples(); });
+
+        constexpr auto bucket_count = Histogram<unsigned long>::bucket_count;
+        Histogram<unsigned long> latencies;
+        previous_latency_counts.resize(sink_counters.size() * bucket_count, 0);
+        for (std::size_t i = 0; i < sink_counters.size(); ++i) {
+            const auto &counters = sink_counters[i];
+            for (std::size_t b = 0; b < bucket_count; ++b) {
+                auto &previous = previous_latency_counts[i * bucket_count + b];
+                const unsigned long count = counters.get_latency_count(b);
+                latencies.record(Histogram<unsigned long>::bucket_value(b),
+                                 count - previous);
+                previous = count;
+            }
+        }
+
+        nlohmann::ordered_json json_stats;
+        json_stats["elapsed time"]    = elapsed_seconds;
+        json_stats["interval length"] = interval_seconds;
+        json_stats["time unit"]       = std::string {timeunit_string} + 's';
+        json_stats["sent tuples"]     = sent_tuples;
+        json_stats["received tuples"] = received_tuples;
+        json_stats["throughput"]      = sent_tuples / interval_seconds;
+        json_stats["received throughput"] =
+            received_tuples / interval_seconds;
+        json_stats["sampled measurements"] = latencies.size();
+        json_stats["mean"]                 = latencies.mean();
+        for (const auto percentile : {0.5, 0.95, 0.99}) {
+            const auto label =
+                std::to_string(static_cast<int>(percentile * 100))
+                + "th percentile";
+            json_stats[label] = latencies.percentile(percentile);
+        }
+        return json_stats;
+    }
+
+    void run(unsigned long interval_in_milliseconds, std::string path) {
+        std::ofstream       fs {path, std::ios::app};
+        const unsigned long start_time    = current_time();
+        unsigned long       previous_time = start_time;
+        std::unique_lock    lock {stop_mutex};
+
+        while (!stop_requested) {
+            stop_condition.wait_for(
+                lock, std::chrono::milliseconds {interval_in_milliseconds});
+            const unsigned long now = current_time();
+            const double        interval_seconds =
+                difference(now, previous_time)
+                / static_cast<double>(timeunit_scale_factor);
+            const double elapsed_seconds =
+                difference(now, start_time)
+                / static_cast<double>(timeunit_scale_factor);
+            previous_time = now;
+
+            if (interval_seconds > 0) {
+                const auto json_stats =
+                    collect_interval(elapsed_seconds, interval_seconds);
+                fs << json_stats.dump() << std::endl;
+            }
+        }
+    }
+
+public:
+    ~LiveMetricsReporter() {
+        stop();
+    }
+
+    /*
+     * Have replicas registering from now on get counters.  Call before
+     * running the graph.
+     */
+    void enable_counters() {
+        counters_enabled = true;
+    }
+
+    ReplicaCountersHandle add_source_replica() {
+        if (!counters_enabled) {
+            return {};
+        }
+        std::lock_guard guard {registration_mutex};
+        return &source_counters.emplace_back(false);
+    }
+
+    ReplicaCountersHandle add_sink_replica() {
+        if (!counters_enabled) {
+            return {};
+        }
+        std::lock_guard guard {registration_mutex};
+        return &sink_counters.emplace_back(true);
+    }
+
+    struct SinkTotals {
+        unsigned long received_tuples   = 0;
+        unsigned long sampled_latencies = 0;
+        double        latency_sum       = 0.0;
+    };
+
+    /*
+     * Sum the counters of all sink replicas registered so far.  Latencies
+     * are summed at histogram bucket resolution.
+     */
+    SinkTotals get_sink_totals() {
+        using LatencyHistogram = Histogram<unsigned long>;
+        std::lock_guard guard {registration_mutex};
+        SinkTotals      totals;
+        for (const auto &counters : sink_counters) {
+            totals.received_tuples += counters.get_tuples();
+            for (std::size_t b = 0; b < LatencyHistogram::bucket_count; ++b) {
+                const unsigned long count = counters.get_latency_count(b);
+                totals.sampled_latencies += count;
+                totals.latency_sum +=
+                    count
+                    * static_cast<double>(LatencyHistogram::bucket_value(b));
+            }
+        }
+        return totals;
+    }
+
+    /*
+     * Start appending one JSON line per interval to a metric file named
+     * after file_name, placed next to the ones written by serialize_json.
+     */
+    void start(unsigned long interval_in_milliseconds,
+               const std::string &file_name,
+               const std::string &output_directory) {
+        assert(interval_in_milliseconds > 0);
+        assert(!reporter_thread.joinable());
+        enable_counters();
+        create_directory_if_not_exists(output_directory.c_str());
+        const auto path = output_directory + "/metric-" + file_name + "-"
+                          + std::to_string(current_time_secs()) + ".jsonl";
+        reporter_thread = std::thread {&LiveMetricsReporter::run, this,
+                                       interval_in_milliseconds, path};
+    }
+
+    void stop() {
+        if (reporter_thread.joinable()) {
+            {
+                std::lock_guard guard {stop_mutex};
+                stop_requested = true;
+            }
+            stop_condition.notify_one();
+            reporter_thread.join();
+        }
+    }
+};
+
+/*
+ * The operator replica running on the calling thread, and when it received
+ * the tuple it is processing.
+ */
+struct HopContext {
+    unsigned short operator_id = 0;
+    unsigned long  received    = 0;
+};
+
+static thread_local HopContext current_hop_context;
+
+/*
+ * Per-hop timestamps carried by a tuple.  Only the tuples picked by a
+ * source's TraceSampler carry any, so an untraced tuple pays for a null
+ * pointer and nothing else.  The first hop is the source, which emits the
+ * tuple at its timestamp; each later hop is an operator that received the
+ * tuple, or the one it was derived from, and emitted it.  A hop is left open,
+ * with no emission time, while an operator holds on to a trace to emit it in
+ * a later call.
+ */
+class TupleTrace {
+public:
+    struct Hop {
+        unsigned long  received;
+        unsigned long  emitted;
+        unsigned short operator_id;
+    };
+
+    static constexpr std::size_t max_hops = 8;
+
+private:
+    struct Hops {
+        std::array<Hop, max_hops> hops;
+        std::size_t               size = 0;
+    };
+
+    std::unique_ptr<Hops> hops;
+
+public:
+    TupleTrace() = default;
+    TupleTrace(TupleTrace &&) = default;
+    TupleTrace &operator=(TupleTrace &&) = default;
+
+    TupleTrace(const TupleTrace &other)
+        : hops {other.hops ? std::make_unique<Hops>(*other.hops) : nullptr} {}
+
+    TupleTrace &operator=(const TupleTrace &other) {
+        hops = other.hops ? std::make_unique<Hops>(*other.hops) : nullptr;
+        return *this;
+    }
+
+    static TupleTrace start(unsigned long timestamp) {
+        TupleTrace trace;
+        trace.hops          = std::make_unique<Hops>();
+        trace.hops->hops[0] = {timestamp, timestamp, 0};
+        trace.hops->size    = 1;
+        return trace;
+    }
+
+    bool is_active() const {
+        return hops != nullptr;
+    }
+
+    /*
+     * Record that the operator currently processing the tuple emits it now,
+     * closing the open hop if there is one.  Meant for operators that pass
+     * on the tuple they received.
+     */
+    void record_hop() {
+        if (!hops) {
+            return;
+        }
+        if (hops->size > 0 && hops->hops[hops->size - 1].emitted == 0) {
+            hops->hops[hops->size - 1].emitted = current_time();
+        } else if (hops->size < max_hops) {
+            hops->hops[hops->size++] = {current_hop_context.received,
+                                        current_time(),
+                                        current_hop_context.operator_id};
+        }
+    }
+
+    /*
+     * Return the trace with an open hop for the operator currently receiving
+     * the tuple, for operators that keep it to emit derived tuples later.
+     */
+    TupleTrace received() const {
+        TupleTrace trace {*this};
+        if (trace.hops && trace.hops->size < max_hops) {
+            trace.hops->hops[trace.hops->size++] = {
+                current_hop_context.received, 0,
+                current_hop_context.operator_id};
+        }
+        return trace;
+    }
+
+    /*
+     * Return the trace of a tuple derived from this one, emitted now by the
+     * operator currently processing it.
+     */
+    TupleTrace forwarded() const {
+        TupleTrace trace {*this};
+        trace.record_hop();
+        return trace;
+    }
+
+    std::size_t size() const {
+        return hops ? hops->size : 0;
+    }
+
+    const Hop &operator[](std::size_t index) const {
+        return hops->hops[index];
+    }
+};
+
+/*
+ * Per-hop latencies seen by a single sink replica, indexed by operator ID.
+ * Queueing is the time between a hop's emission and the next hop's
+ * reception, processing the time between an operator's reception and
+ * emission of a tuple.
+ */
+class HopSamples {
+    std::vector<Histogram<unsigned long>> queueing;
+    std::vector<Histogram<unsigned long>> processing;
+
+    void reserve_operator(unsigned short operator_id) {
+        if (operator_id >= queueing.size()) {
+            queueing.resize(operator_id + 1);
+            processing.resize(operator_id + 1);
+        }
+    }
+
+public:
+    /*
+     * Record the hops of a tuple that reached the sink currently processing
+     * it.  The sink itself only contributes its queueing time.
+     */
+    void record(const TupleTrace &trace) {
+        const std::size_t size = trace.size();
+        if (size == 0) {
+            return;
+        }
+        for (std::size_t i = 1; i < size; ++i) {
+            const auto &hop = trace[i];
+            reserve_operator(hop.operator_id);
+            queueing[hop.operator_id].record(
+                difference(hop.received, trace[i - 1].emitted));
+            processing[hop.operator_id].record(
+                difference(hop.emitted, hop.received));
+        }
+
+        const auto sink_id = current_hop_context.operator_id;
+        reserve_operator(sink_id);
+        queueing[sink_id].record(difference(current_hop_context.received,
+                                            trace[size - 1].emitted));
+    }
+
+    const std::vector<Histogram<unsigned long>> &get_queueing() const {
+        return queueing;
+    }
+
+    const std::vector<Histogram<unsigned long>> &get_processing() const {
+        return processing;
+    }
+};
+
+/*
+ * Registry of the operators seen by traced tuples, and of their per-hop
+ * latency metrics.  Operators register themselves by name on their first
+ * call, and sink replicas merge their HopSamples at the end of the stream.
+ */
+class HopTracer {
+    std::vector<std::string>          operator_names;
+    std::deque<Metric<unsigned long>> queueing_metrics;
+    std::deque<Metric<unsigned long>> processing_metrics;
+    std::mutex                        registration_mutex;
+    SamplingPolicy                    sampling_policy;
+    std::string                       metric_prefix;
+    bool                              enabled = false;
+
+public:
+    /*
+     * Reservoir sampling can only choose a tuple once it has seen all of
+     * them, so sources trace according to the time policy instead.
+     */
+    void enable(const SamplingPolicy &policy, const std::string &prefix) {
+        sampling_policy = policy;
+        if (sampling_policy.mode == SamplingMode::Reservoir) {
+            sampling_policy.mode = SamplingMode::Time;
+        }
+        metric_prefix = prefix;
+        enabled       = true;
+    }
+
+    bool is_enabled() const {
+        return enabled;
+    }
+
+    const SamplingPolicy &get_sampling_policy() const {
+        return sampling_policy;
+    }
+
+    unsigned short get_operator_id(const std::string &operator_name) {
+        std::lock_guard guard {registration_mutex};
+        const auto      position = std::find(
+            operator_names.begin(), operator_names.end(), operator_name);
+        if (position != operator_names.end()) {
+            return position - operator_names.begin();
+        }
+
+        std::string metric_name = metric_prefix + '-' + operator_name;
+        std::replace(metric_name.begin(), metric_name.end(), ' ', '-');
+        operator_names.push_back(operator_name);
+        queueing_metrics.emplace_back(metric_name + "-queueing");
+        processing_metrics.emplace_back(metric_name + "-processing");
+        return operator_names.size() - 1;
+    }
+
+    void merge(const HopSamples &samples) {
+        const auto &queueing   = samples.get_queueing();
+        const auto &processing = samples.get_processing();
+        for (std::size_t i = 0; i < queueing.size(); ++i) {
+            if (!queueing[i].empty()) {
+                queueing_metrics[i].merge(queueing[i]);
+            }
+            if (!processing[i].empty()) {
+                processing_metrics[i].merge(processing[i]);
+            }
+        }
+    }
+
+    template<typename Parameters>
+    void serialize(const Parameters &parameters) const {
+        for (const auto *metrics : {&queueing_metrics, &processing_metrics}) {
+            for (const auto &metric : *metrics) {
+                if (metric.empty()) {
+                    continue;
+                }
+                const auto stats =
+                    get_distribution_stats(metric, parameters, metric.size());
+                serialize_json(stats, metric.name(),
+                               parameters.metric_output_directory);
+            }
+        }
+    }
+};
+
+static HopTracer global_hop_tracer;
+
+/*
+ * Picks the tuples a source replica traces, if tracing is enabled.
+ */
+class TraceSampler {
+    std::optional<LatencySampler> sampler;
+
+public:
+    TraceSampler() {
+        if (global_hop_tracer.is_enabled()) {
+            sampler.emplace(global_hop_tracer.get_sampling_policy());
+        }
+    }
+
+    TupleTrace start_trace(unsigned long timestamp) {
+        if (sampler && sampler->should_sample(timestamp)) {
+            return TupleTrace::start(timestamp);
+        }
+        return {};
+    }
+};
+
+/*
+ * Sets current_hop_context for the length of an operator call.  This is done
+ * for every call while tracing, since operators that reorder or batch tuples
+ * may emit a traced tuple while processing an untraced one.  Chained
+ * operators run inside the push of the one before them, so the previous
+ * context is restored on the way out.
+ */
+class HopScope {
+    std::optional<HopContext> previous_context;
+
+public:
+    HopScope(unsigned short operator_id, bool is_tracing) {
+        if (is_tracing) {
+            previous_context    = current_hop_context;
+            current_hop_context = {operator_id, current_time()};
+        }
+    }
+
+    HopScope(const HopScope &) = delete;
+    HopScope &operator=(const HopScope &) = delete;
+
+    ~HopScope() {
+        if (previous_context) {
+            current_hop_context = *previous_context;
+        }
+    }
+};
+
+/*
+ * Return a cheap, monotonically increasing cycle count, meant for timing
+ * short sections of code.  Where no cycle counter is available, fall back
+ * to current_time().
+ */
+static inline unsigned long read_cycle_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return current_time();
+#endif
+}
+
+/*
+ * Per-thread performance counters, read through perf_event_open(2).  The
+ * counters are bound to the thread that creates the group and start out
+ * disabled; they may be read from any thread, even after the owning one has
+ * exited.  Hardware events only count user space code, so that they are
+ * available under the default perf_event_paranoid setting, while context
+ * switches can only be seen when kernel events are allowed.  Events that
+ * cannot be opened are reported as missing.
+ */
+class PerfCounterGroup {
+public:
+    enum Event {
+        cycles,
+        instructions,
+        llc_misses,
+        branch_misses,
+        context_switches,
+        event_count
+    };
+
+    using Values = std::array<std::optional<unsigned long>, event_count>;
+
+private:
+    std::array<int, event_count> descriptors;
+    bool                         running = false;
+
+#if defined(__linux__)
+    static int open_event(Event event) {
+        perf_event_attr attributes {};
+        attributes.size        = sizeof attributes;
+        attributes.disabled    = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                                 | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (event) {
+        case cycles:
+            attributes.type   = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case instructions:
+            attributes.type   = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case llc_misses:
+            attributes.type   = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case branch_misses:
+            attributes.type   = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case context_switches:
+            attributes.type   = PERF_TYPE_SOFTWARE;
+            attributes.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+            break;
+        default:
+            return -1;
+        }
+        if (event != context_switches) {
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv     = 1;
+        }
+        return static_cast<int>(
+            syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+#else
+    static int open_event(Event) {
+        return -1;
+    }
+#endif
+
+public:
+    PerfCounterGroup() {
+        for (int event = 0; event < event_count; ++event) {
+            descriptors[event] = open_event(static_cast<Event>(event));
+        }
+    }
+
+    PerfCounterGroup(const PerfCounterGroup &) = delete;
+    PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+    ~PerfCounterGroup() {
+#if defined(__linux__)
+        for (const int descriptor : descriptors) {
+            if (descriptor >= 0) {
+                close(descriptor);
+            }
+        }
+#endif
+    }
+
+    static const char *get_event_name(Event event) {
+        switch (event) {
+        case cycles:
+            return "cycles";
+        case instructions:
+            return "instructions";
+        case llc_misses:
+            return "LLC misses";
+        case branch_misses:
+            return "branch misses";
+        case context_switches:
+            return "context switches";
+        default:
+            return "unknown";
+        }
+    }
+
+    bool is_available(Event event) const {
+        return descriptors[event] >= 0;
+    }
+
+    /*
+     * Enabling and disabling the counters costs a system call per event, so
+     * callers should only do it when the state actually changes.
+     */
+    void set_running(bool should_run) {
+        if (running == should_run) {
+            return;
+        }
+        running = should_run;
+#if defined(__linux__)
+        const auto request =
+            should_run ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE;
+        for (const int descriptor : descriptors) {
+            if (descriptor >= 0) {
+                ioctl(descriptor, request, 0);
+            }
+        }
+#endif
+    }
+
+    /*
+     * Counts are scaled up when the kernel had to multiplex the counters,
+     * i.e. when they were enabled for longer than they were running.
+     */
+    Values read_values() const {
+        Values values;
+#if defined(__linux__)
+        for (int event = 0; event < event_count; ++event) {
+            std::uint64_t buffer[3] {};
+            if (descriptors[event] < 0
+                || read(descriptors[event], buffer, sizeof buffer)
+                       != sizeof buffer) {
+                continue;
+            }
+            const auto [count, time_enabled, time_running] = buffer;
+            const double scale =
+                time_running > 0 && time_running < time_enabled
+                    ? time_enabled / static_cast<double>(time_running)
+                    : 1.0;
+            values[event] = static_cast<unsigned long>(count * scale);
+        }
+#endif
+        return values;
+    }
+};
+
+/*
+ * Statistics gathered by a single replica of an InstrumentedFunctor.  Only
+ * the owning replica writes them, and they are read once the graph is done.
+ */
+struct OperatorReplicaStats {
+    std::string                     operator_name;
+    std::size_t                     replica_index;
+    bool                            counts_outputs;
+    unsigned long                   tuples_in   = 0;
+    unsigned long                   tuples_out  = 0;
+    unsigned long                   busy_cycles = 0;
+    unsigned long                   first_cycle = 0;
+    unsigned long                   last_cycle  = 0;
+    Histogram<unsigned long>        service_cycles;
+    std::optional<PerfCounterGroup> perf_counters;
+    OperatorReplicaStats(const std::string &name, std::size_t index,
+                         bool counts)
+        : operator_name {name}, replica_index {index},
+          counts_outputs {counts} {}
+};
+
+class OperatorStatsRegistry {
+    std::deque<OperatorReplicaStats> replicas;
+    std::mutex                       registration_mutex;
+    bool                             enabled                = false;
+    bool                             collects_perf_counters = false;
+
+public:
+    /*
+     * Performance counters are probed once up front, so that a machine that
+     * exposes none of them is reported before the graph starts.
+     */
+    void enable(bool with_perf_counters = false) {
+        enabled = true;
+        if (!with_perf_counters) {
+            return;
+        }
+        const PerfCounterGroup probe;
+        std::string            missing_events;
+        bool                   any_available = false;
+        for (int event = 0; event < PerfCounterGroup::event_count; ++event) {
+            const auto e = static_cast<PerfCounterGroup::Event>(event);
+            if (probe.is_available(e)) {
+                any_available = true;
+            } else {
+                missing_events += missing_events.empty() ? "" : ", ";
+                missing_events += PerfCounterGroup::get_event_name(e);
+            }
+        }
+        if (!any_available) {
+            std::cerr << "Error: no performance counters are available, "
+                         "check the kernel.perf_event_paranoid setting\n";
+            std::exit(EXIT_FAILURE);
+        }
+        if (!missing_events.empty()) {
+            std::cerr << "Warning: unavailable performance counters: "
+                      << missing_events << '\n';
+        }
+        collects_perf_counters = true;
+    }
+
+    bool is_enabled() const {
+        return enabled;
+    }
+
+    bool has_perf_counters() const {
+        return collects_perf_counters;
+    }
+
+    /*
+     * Must be called from the thread running the replica, as performance
+     * counters are bound to the calling thread.
+     */
+    OperatorReplicaStats &add_replica(const std::string &operator_name,
+                                      std::size_t        replica_index,
+                                      bool               counts_outputs) {
+        std::lock_guard guard {registration_mutex};
+        auto &stats = replicas.emplace_back(operator_name, replica_index,
+                                            counts_outputs);
+        if (collects_perf_counters) {
+            stats.perf_counters.emplace();
+        }
+        return stats;
+    }
+
+    const std::deque<OperatorReplicaStats> &get_replicas() const {
+        return replicas;
+    }
+};
+
+template<typename Signature>
+struct CallSignature;
+
+template<typename Class, typename Result, typename... Arguments>
+struct CallSignature<Result (Class::*)(Arguments...)> {
+    using result    = Result;
+    using arguments = std::tuple<Arguments...>;
+};
+
+template<typename Class, typename Result, typename... Arguments>
+struct CallSignature<Result (Class::*)(Arguments...) const>
+    : CallSignature<Result (Class::*)(Arguments...)> {};
+
+template<typename Tuple,
+         typename Indices = std::make_index_sequence<
+             std::tuple_size_v<Tuple> == 0 ? 0 : std::tuple_size_v<Tuple> - 1>>
+struct DropLastElement;
+
+template<typename Tuple, std::size_t... I>
+struct DropLastElement<Tuple, std::index_sequence<I...>> {
+    using type = std::tuple<std::tuple_element_t<I, Tuple>...>;
+};
+
+template<typename Arguments>
+static constexpr bool takes_runtime_context() {
+    constexpr auto size = std::tuple_size_v<Arguments>;
+    if constexpr (size == 0) {
+        return false;
+    } else {
+        return std::is_same_v<std::tuple_element_t<size - 1, Arguments>,
+                              wf::RuntimeContext &>;
+    }
+}
+
+template<typename T>
+struct IsOptional : std::false_type {};
+
+template<typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+struct IsShipper : std::false_type {};
+
+template<typename T>
+struct IsShipper<wf::Shipper<T>> : std::true_type {};
+
+template<typename T, typename = void>
+struct CountsDeliveries : std::false_type {};
+
+template<typename T>
+struct CountsDeliveries<
+    T, std::void_t<decltype(std::declval<T &>().getNumDelivered())>>
+    : std::true_type {};
+
+/*
+ * Decorator for Map, Filter, FlatMap, Sink and incremental window functors.
+ * When the registry is enabled, every replica counts the tuples going in and
+ * out and times each call with read_cycle_counter(); otherwise calls are just
+ * forwarded.  The wrapper always exposes the variant taking a RuntimeContext,
+ * so that it can key its statistics by replica index.  Outputs pushed through
+ * a Shipper are counted from the change in its number of delivered tuples
+ * across the call.  Windows emitted by the runtime are not visible here and
+ * are therefore not counted.
+ */
+template<typename Functor,
+         typename Signature = CallSignature<decltype(&Functor::operator())>,
+         bool with_context =
+             takes_runtime_context<typename Signature::arguments>(),
+         typename Inputs = std::conditional_t<
+             with_context,
+             typename DropLastElement<typename Signature::arguments>::type,
+             typename Signature::arguments>>
+class InstrumentedFunctor;
+
+template<typename Functor, typename Signature, bool with_context,
+         typename... Inputs>
+class InstrumentedFunctor<Functor, Signature, with_context,
+                          std::tuple<Inputs...>> {
+    using Result = typename Signature::result;
+
+    static constexpr bool is_sink =
+        (IsOptional<std::decay_t<Inputs>>::value || ...);
+    static constexpr bool uses_shipper =
+        (IsShipper<std::decay_t<Inputs>>::value || ...);
+    static constexpr bool updates_window =
+        !uses_shipper && sizeof...(Inputs) == 2;
+    static constexpr bool counts_outputs =
+        !uses_shipper
+        || (CountsDeliveries<std::decay_t<Inputs>>::value || ...);
+
+    Functor                functor;
+    std::string            operator_name;
+    OperatorStatsRegistry *registry;
+    OperatorReplicaStats * stats           = nullptr;
+    unsigned short         hop_operator_id = 0;
+    bool                   initialized     = false;
+
+    Result invoke(Inputs &&...inputs, wf::RuntimeContext &context) {
+        if constexpr (with_context) {
+            return functor(std::forward<Inputs>(inputs)..., context);
+        } else {
+            return functor(std::forward<Inputs>(inputs)...);
+        }
+    }
+
+    /*
+     * Sinks receive an empty optional once the stream is over, which is not
+     * a tuple and is not timed.
+     */
+    static bool is_end_of_stream(const Inputs &...inputs) {
+        if constexpr (is_sink) {
+            return (is_empty_optional(inputs) || ...);
+        } else {
+            return false;
+        }
+    }
+
+    template<typename T>
+    static bool is_empty_optional(const T &input) {
+        if constexpr (IsOptional<T>::value) {
+            return !input.has_value();
+        } else {
+            return false;
+        }
+    }
+
+    /*
+     * Return the number of tuples delivered so far by the Shippers among
+     * inputs, if they keep count.
+     */
+    static unsigned long get_delivered_count(Inputs &...inputs) {
+        return (get_delivered_count_of(inputs) + ... + 0UL);
+    }
+
+    template<typename T>
+    static unsigned long get_delivered_count_of(T &input) {
+        if constexpr (CountsDeliveries<std::decay_t<T>>::value) {
+            return input.getNumDelivered();
+        } else {
+            return 0;
+        }
+    }
+
+    void record_call(unsigned long start_cycle, unsigned long outputs) {
+        const unsigned long end_cycle = read_cycle_counter();
+        const unsigned long cycles    = end_cycle - start_cycle;
+        if (stats->tuples_in == 0) {
+            stats->first_cycle = start_cycle;
+        }
+        ++stats->tuples_in;
+        stats->tuples_out += outputs;
+        stats->busy_cycles += cycles;
+        stats->last_cycle = end_cycle;
+        stats->service_cycles.record(cycles);
+    }
+
+public:
+    InstrumentedFunctor(const Functor &f, const std::string &name,
+                        OperatorStatsRegistry &r)
+        : functor {f}, operator_name {name}, registry {&r} {}
+
+    Result operator()(Inputs... inputs, wf::RuntimeContext &context) {
+        if (!initialized) {
+            initialized = true;
+            global_thread_placement.pin_current_thread(
+                operator_name, context.getReplicaIndex());
+            if (registry->is_enabled()) {
+                stats = &registry->add_replica(operator_name,
+                                               context.getReplicaIndex(),
+                                               counts_outputs);
+            }
+            if (global_hop_tracer.is_enabled()) {
+                hop_operator_id =
+                    global_hop_tracer.get_operator_id(operator_name);
+            }
+        }
+
+        const HopScope hop_scope {hop_operator_id,
+                                  global_hop_tracer.is_enabled()};
+        if (!stats || is_end_of_stream(inputs...)) {
+            return invoke(std::forward<Inputs>(inputs)..., context);
+        }
+        const bool is_measured = global_measurement_window.contains_now();
+        if (stats->perf_counters) {
+            stats->perf_counters->set_running(is_measured);
+        }
+        if (!is_measured) {
+            return invoke(std::forward<Inputs>(inputs)..., context);
+        }
+
+        if constexpr (std::is_void_v<Result>) {
+            const unsigned long delivered   = get_delivered_count(inputs...);
+            const unsigned long start_cycle = read_cycle_counter();
+            invoke(std::forward<Inputs>(inputs)..., context);
+            if constexpr (uses_shipper) {
+                record_call(start_cycle,
+                            get_delivered_count(inputs...) - delivered);
+            } else {
+                record_call(start_cycle, is_sink || updates_window ? 0 : 1);
+            }
+        } else {
+            const unsigned long start_cycle = read_cycle_counter();
+            Result result = invoke(std::forward<Inputs>(inputs)..., context);
+            if constexpr (std::is_same_v<Result, bool>) {
+                record_call(start_cycle, result ? 1 : 0);
+            } else {
+                record_call(start_cycle, 1);
+            }
+            return result;
+        }
+    }
+};
+
+template<typename Functor>
+InstrumentedFunctor(const Functor &, const std::string &,
+                    OperatorStatsRegistry &) -> InstrumentedFunctor<Functor>;
+
+/*
+ * Ratios are only reported when the counters they depend on are available.
+ * The per-tuple figures count everything the replica's thread did while
+ * measuring, including the runtime's own work between calls.
+ */
+static inline nlohmann::ordered_json
+get_perf_counter_stats(const PerfCounterGroup::Values &values,
+                       unsigned long                   tuples) {
+    using Group = PerfCounterGroup;
+    nlohmann::ordered_json json_stats;
+    for (int event = 0; event < Group::event_count; ++event) {
+        if (values[event]) {
+            json_stats[Group::get_event_name(static_cast<Group::Event>(
+                event))] = *values[event];
+        }
+    }
+    if (values[Group::cycles] && values[Group::instructions]
+        && *values[Group::cycles] > 0) {
+        json_stats["instructions per cycle"] =
+            *values[Group::instructions]
+            / static_cast<double>(*values[Group::cycles]);
+    }
+    for (const auto event :
+         {Group::instructions, Group::llc_misses, Group::branch_misses}) {
+        if (values[event] && tuples > 0) {
+            json_stats[std::string {Group::get_event_name(event)}
+                       + " per tuple"] =
+                *values[event] / static_cast<double>(tuples);
+        }
+    }
+    return json_stats;
+}
+
+template<typename Parameters>
+static inline nlohmann::ordered_json
+get_operator_stats(const OperatorStatsRegistry &registry,
+                   const std::string &name, const Parameters &parameters) {
+    nlohmann::ordered_json json_stats;
+    json_stats["date"]             = get_datetime_string();
+    json_stats["name"]             = name;
+    json_stats["parallelism"]      = parameters.parallelism;
+    json_stats["batch size"]       = parameters.batch_size;
+    json_stats["duration"]         = parameters.duration;
+    json_stats["tuple rate"]       = parameters.tuple_rate;
+    json_stats["chaining enabled"] = parameters.use_chaining;
+    json_stats["time unit"]        = "cycles";
+    json_stats["perf counters"]    = registry.has_perf_counters();
+    json_stats["execution mode"] =
+        get_string_from_execution_mode(parameters.execution_mode);
+    json_stats["time policy"] =
+        get_string_from_time_policy(parameters.time_policy);
+    global_thread_placement.describe(json_stats);
+
+    std::vector<const OperatorReplicaStats *> replicas;
+    for (const auto &replica : registry.get_replicas()) {
+        replicas.push_back(&replica);
+    }
+    std::stable_sort(replicas.begin(), replicas.end(),
+                     [](const auto *a, const auto *b) {
+                         return a->replica_index < b->replica_index;
+                     });
+
+    std::vector<std::string> operator_names;
+    for (const auto *replica : replicas) {
+        if (std::find(operator_names.begin(), operator_names.end(),
+                      replica->operator_name)
+            == operator_names.end()) {
+            operator_names.push_back(replica->operator_name);
+        }
+    }
+
+    for (const auto &operator_name : operator_names) {
+        nlohmann::ordered_json operator_stats;
+        auto          replica_list     = nlohmann::ordered_json::array();
+        unsigned long total_tuples_in  = 0;
+        unsigned long total_tuples_out = 0;
+        unsigned long max_tuples_in    = 0;
+        unsigned long replica_count    = 0;
+        bool          counts_outputs   = true;
+
+        PerfCounterGroup::Values total_perf_values;
+
+        for (const auto *replica : replicas) {
+            if (replica->operator_name != operator_name) {
+                continue;
+            }
+            const auto &service_cycles = replica->service_cycles;
+            const unsigned long active_cycles =
+                replica->last_cycle - replica->first_cycle;
+
+            nlohmann::ordered_json replica_stats;
+            replica_stats["replica"]     = replica->replica_index;
+            replica_stats["tuples in"]   = replica->tuples_in;
+            if (replica->counts_outputs) {
+                replica_stats["tuples out"] = replica->tuples_out;
+            }
+            replica_stats["busy cycles"] = replica->busy_cycles;
+            replica_stats["utilisation"] =
+                active_cycles > 0
+                    ? replica->busy_cycles / static_cast<double>(active_cycles)
+                    : 0.0;
+            replica_stats["mean"] = service_cycles.mean();
+            for (const auto percentile : {0.5, 0.95, 0.99}) {
+                const auto label =
+                    std::to_string(static_cast<int>(percentile * 100))
+                    + "th percentile";
+                replica_stats[label] = service_cycles.percentile(percentile);
+            }
+            if (replica->perf_counters) {
+                const auto values = replica->perf_counters->read_values();
+                replica_stats["perf counters"] =
+                    get_perf_counter_stats(values, replica->tuples_in);
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (values[i]) {
+                        total_perf_values[i] =
+                            total_perf_values[i].value_or(0) + *values[i];
+                    }
+                }
+            }
+            replica_list.push_back(replica_stats);
+
+            total_tuples_in += replica->tuples_in;
+            total_tuples_out += replica->tuples_out;
+            max_tuples_in  = std::max(max_tuples_in, replica->tuples_in);
+            counts_outputs = counts_outputs && replica->counts_outputs;
+            ++replica_count;
+        }
+
+        /*
+         * A load imbalance of 1 means that every replica of the operator got
+         * the same number of tuples.
+         */
+        const double mean_tuples_in =
+            total_tuples_in / static_cast<double>(replica_count);
+        operator_stats["tuples in"] = total_tuples_in;
+        if (counts_outputs) {
+            operator_stats["tuples out"] = total_tuples_out;
+        }
+        operator_stats["load imbalance"] =
+            mean_tuples_in > 0 ? max_tuples_in / mean_tuples_in : 1.0;
+        if (registry.has_perf_counters()) {
+            operator_stats["perf counters"] =
+                get_perf_counter_stats(total_perf_values, total_tuples_in);
+        }
+        operator_stats["replicas"] = replica_list;
+        json_stats["operators"][operator_name] = operator_stats;
+    }
+    return json_stats;
 }
 
 static inline void print_statistics(unsigned long elapsed_time,
+                                    unsigned long measured_time,
                                     unsigned long duration_in_seconds,
                                     unsigned long sent_tuples,
                                     double        average_latency,
                                     unsigned long received_tuples) {
     const double elapsed_time_in_seconds =
         elapsed_time / static_cast<double>(timeunit_scale_factor);
+    const double measured_time_in_seconds =
+        measured_time / static_cast<double>(timeunit_scale_factor);
 
     const double throughput =
-        elapsed_time > 0 ? sent_tuples / static_cast<double>(elapsed_time)
-                         : sent_tuples;
+        measured_time > 0 ? sent_tuples / static_cast<double>(measured_time)
+                          : sent_tuples;
 
     const double throughput_in_seconds = throughput * timeunit_scale_factor;
     const double service_time          = 1 / throughput;
@@ -368,6 +3258,8 @@ static inline void print_statistics(unsigned long elapsed_time,
               << "Excess time after source stopped: " << excess_time << ' '
               << timeunit_string << "s ( " << excess_time_in_seconds
               << " seconds)\n"
+              << "Measured time: " << measured_time << ' ' << timeunit_string
+              << "s (" << measured_time_in_seconds << " seconds)\n"
               << "Total number of tuples sent: " << sent_tuples << '\n'
               << "Total number of tuples recieved: " << received_tuples << '\n'
               << "Throughput: " << throughput << " tuples per "